@@ -0,0 +1,32 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Helpers shared by the benchmarks, built with 'make bench'.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Current time of a monotonic clock in milliseconds.
+ */
+static inline double bench_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * Print the time spent since start.
+ *
+ * @param name what was measured.
+ * @param start value of bench_now before the work started.
+ */
+static inline void bench_report(const char *name, double start) {
+  printf("  %-40s %10.2f ms\n", name, bench_now() - start);
+}
+
+#endif  // BENCH_H
@@ -0,0 +1,124 @@
+/*
+ * Deduplicate 1M include paths, about a quarter of them unique, by sorting
+ * them or with a hash table over the same paths packed in a string_array.
+ */
+
+#include "dynamic_array.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "string_array.h"
+
+#define BENCH_PATHS 1000000
+
+static void free_str(void **str) { free(str); }
+
+/**
+ * Create an array of include paths in random order, the same ones on every
+ * call.
+ */
+static dynamic_array *create_paths(void) {
+  dynamic_array *array = NULL;
+  char path[128];
+
+  dynamic_array_create(&array, sizeof(char *), free_str, NULL);
+  srand(1);
+
+  for (unsigned int i = 0; i < BENCH_PATHS; i++) {
+    unsigned int id = rand() % (BENCH_PATHS / 4);
+
+    snprintf(path, sizeof(path), "/usr/include/lib%u/include/module%u/sub%u",
+             id % 97, id % 1009, id);
+    dynamic_array_add_str(array, strdup(path));
+  }
+
+  return array;
+}
+
+// How run deduplicates the paths.
+typedef enum bench_dedup {
+  BENCH_SORT_THEN_UNIQUE,  // sort_str followed by unique_str.
+  BENCH_SORT_UNIQUE,       // sort_unique_str.
+  BENCH_STRING_ARRAY,      // string_array_dedup.
+} bench_dedup;
+
+/**
+ * Deduplicate the paths with string_array_dedup, the time spent copying
+ * them into the string_array is not counted.
+ */
+static void run_string_array(dynamic_array *array) {
+  string_array *packed = NULL;
+  char *path = NULL;
+
+  string_array_create(&packed);
+
+  for (int i = 0; i < dynamic_array_get_size(array); i++) {
+    dynamic_array_find_ref_str(array, i, (void **)&path);
+    string_array_append(packed, path, strlen(path));
+  }
+
+  double start = bench_now();
+
+  string_array_dedup(packed);
+  bench_report("string_array_dedup", start);
+
+  printf("  %-40s %10d\n", "unique strings", string_array_get_size(packed));
+  string_array_destroy(&packed);
+}
+
+/**
+ * Deduplicate the paths in a new process, so every run starts from the
+ * same heap.
+ *
+ * @param how which functions deduplicate the paths.
+ */
+static void run(bench_dedup how) {
+  if (fork() != 0) {
+    wait(NULL);
+    return;
+  }
+
+  dynamic_array *array = create_paths();
+  double start = bench_now();
+
+  switch (how) {
+    case BENCH_SORT_THEN_UNIQUE:
+      dynamic_array_sort_str(array);
+      bench_report("sort_str", start);
+
+      start = bench_now();
+      dynamic_array_unique_str(array);
+      bench_report("unique_str", start);
+      printf("  %-40s %10d\n", "unique strings",
+             dynamic_array_get_size(array));
+      break;
+    case BENCH_SORT_UNIQUE:
+      dynamic_array_sort_unique_str(array);
+      bench_report("sort_unique_str", start);
+      printf("  %-40s %10d\n", "unique strings",
+             dynamic_array_get_size(array));
+      break;
+    case BENCH_STRING_ARRAY:
+      run_string_array(array);
+      break;
+  }
+
+  dynamic_array_destroy(&array);
+
+  exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+  printf("dynamic_array, %d strings\n", BENCH_PATHS);
+  fflush(stdout);
+
+  run(BENCH_SORT_THEN_UNIQUE);
+  run(BENCH_SORT_UNIQUE);
+  run(BENCH_STRING_ARRAY);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+/*
+ * Store 1M short strings in a string_array and in a dynamic_array of
+ * individually allocated strings, then walk and free them.
+ */
+
+#include "string_array.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "dynamic_array.h"
+
+#define BENCH_STRINGS 1000000
+
+static void free_str(void **str) { free(str); }
+
+/**
+ * Bytes currently allocated from the heap.
+ */
+static size_t heap_used(void) {
+  struct mallinfo2 info = mallinfo2();
+
+  return info.uordblks + info.hblkhd;
+}
+
+#define BENCH_STRING_SIZE 20
+
+// Strings to store, generated before anything is timed.
+static char strings[BENCH_STRINGS][BENCH_STRING_SIZE];
+static unsigned int lengths[BENCH_STRINGS];
+
+static void make_strings(void) {
+  for (unsigned int i = 0; i < BENCH_STRINGS; i++) {
+    lengths[i] = snprintf(strings[i], BENCH_STRING_SIZE, "--option-%u",
+                          i * 2654435761U % BENCH_STRINGS);
+  }
+}
+
+/**
+ * Sum the characters of every string, so the walk is not optimized out.
+ */
+static unsigned long checksum(const char *str, unsigned int length) {
+  unsigned long sum = 0;
+
+  for (unsigned int i = 0; i < length; i++) {
+    sum += (unsigned char)str[i];
+  }
+
+  return sum;
+}
+
+static void run_string_array(void) {
+  string_array *array = NULL;
+  const char *str = NULL;
+  unsigned int length = 0;
+  unsigned long sum = 0;
+  size_t used = heap_used();
+  double start = bench_now();
+
+  string_array_create(&array);
+  for (unsigned int i = 0; i < BENCH_STRINGS; i++) {
+    string_array_append(array, strings[i], lengths[i]);
+  }
+  bench_report("string_array append", start);
+  printf("  %-40s %10.2f MB\n", "string_array footprint",
+         (heap_used() - used) / 1e6);
+
+  start = bench_now();
+  for (unsigned int i = 0; string_array_get(array, i, &str, &length) == 0;
+       i++) {
+    sum += checksum(str, length);
+  }
+  bench_report("string_array iterate", start);
+
+  start = bench_now();
+  string_array_destroy(&array);
+  bench_report("string_array destroy", start);
+  printf("  %-40s %10lu\n", "checksum", sum);
+}
+
+static void run_dynamic_array(void) {
+  dynamic_array *array = NULL;
+  char *str = NULL;
+  unsigned long sum = 0;
+  size_t used = heap_used();
+  double start = bench_now();
+
+  dynamic_array_create(&array, sizeof(char *), free_str, NULL);
+  for (unsigned int i = 0; i < BENCH_STRINGS; i++) {
+    dynamic_array_add_str(array, strdup(strings[i]));
+  }
+  bench_report("dynamic_array add_str", start);
+  printf("  %-40s %10.2f MB\n", "dynamic_array footprint",
+         (heap_used() - used) / 1e6);
+
+  start = bench_now();
+  for (unsigned int i = 0;
+       dynamic_array_find_ref_str(array, i, (void **)&str) == 0; i++) {
+    sum += checksum(str, strlen(str));
+  }
+  bench_report("dynamic_array iterate", start);
+
+  start = bench_now();
+  dynamic_array_destroy(&array);
+  bench_report("dynamic_array destroy", start);
+  printf("  %-40s %10lu\n", "checksum", sum);
+}
+
+/**
+ * Run a scenario in a new process, so every run starts from the same heap.
+ */
+static void run(void (*scenario)(void)) {
+  if (fork() != 0) {
+    wait(NULL);
+    return;
+  }
+
+  scenario();
+  exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+  printf("string_array, %d strings\n", BENCH_STRINGS);
+  fflush(stdout);
+
+  make_strings();
+  run(run_string_array);
+  run(run_dynamic_array);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*
+ * Build 16MB of text one character at a time and in word sized chunks,
+ * with string_builder and with a dynamic_array of char, which is what
+ * string_builder used to wrap.
+ */
+
+#include "string_builder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "dynamic_array.h"
+
+#define BENCH_BYTES (16 << 20)
+
+// Words of a command line, appended in turn like concat_argv does. Padded,
+// dynamic_array_add_many reads a pointer worth of bytes from its input.
+static const char text[256] =
+    "prog --input=/usr/share/data/file.txt --verbose -n 42 --output out.json "
+    "--level=3 -x --name 'some value' --ratio 0.75 --count=1000000 -- rest ";
+static unsigned int text_length;
+
+/**
+ * Find where the word starting at begin ends, including its space.
+ */
+static unsigned int word_end(unsigned int begin) {
+  const char *space = strchr(text + begin, ' ');
+
+  return space - text + 1;
+}
+
+static void bench_builder_chars(void) {
+  string_builder sb;
+  double start = bench_now();
+
+  string_builder_init(&sb, NULL, 0);
+  for (unsigned int i = 0; i < BENCH_BYTES; i++) {
+    string_builder_append_char(&sb, text[i % (text_length)]);
+  }
+  bench_report("string_builder append_char", start);
+
+  string_builder_release(&sb);
+}
+
+static void bench_builder_chunks(void) {
+  string_builder sb;
+  unsigned int begin = 0;
+  double start = bench_now();
+
+  string_builder_init(&sb, NULL, 0);
+  while (sb.length < BENCH_BYTES) {
+    unsigned int end = word_end(begin);
+
+    string_builder_append(&sb, text + begin, end - begin);
+    begin = end == text_length ? 0 : end;
+  }
+  bench_report("string_builder append", start);
+
+  string_builder_release(&sb);
+}
+
+static void bench_array_chars(void) {
+  dynamic_array *array = NULL;
+  double start = bench_now();
+
+  dynamic_array_create(&array, sizeof(char), NULL, NULL);
+  for (unsigned int i = 0; i < BENCH_BYTES; i++) {
+    dynamic_array_add(array, &text[i % (text_length)]);
+  }
+  bench_report("dynamic_array add", start);
+
+  dynamic_array_destroy(&array);
+}
+
+static void bench_array_chunks(void) {
+  dynamic_array *array = NULL;
+  unsigned int begin = 0;
+  unsigned int length = 0;
+  double start = bench_now();
+
+  dynamic_array_create(&array, sizeof(char), NULL, NULL);
+  while (length < BENCH_BYTES) {
+    unsigned int end = word_end(begin);
+
+    dynamic_array_add_many(array, (void **)(text + begin), end - begin);
+    length += end - begin;
+    begin = end == text_length ? 0 : end;
+  }
+  bench_report("dynamic_array add_many", start);
+
+  dynamic_array_destroy(&array);
+}
+
+int main(void) {
+  printf("string_builder, %d bytes\n", BENCH_BYTES);
+  text_length = strlen(text);
+
+  bench_builder_chars();
+  bench_array_chars();
+  bench_builder_chunks();
+  bench_array_chunks();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/*
+ * Search 16MB haystacks for needles placed at the very end, with
+ * string_slice_find and with memmem. The two take turns and the best of
+ * BENCH_ROUNDS runs is kept, a single run mostly measures which one found
+ * the haystack in the cache.
+ */
+
+#define _GNU_SOURCE
+#include "string_slice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_BYTES (16 << 20)
+#define BENCH_NEEDLE_MAX 256
+#define BENCH_ROUNDS 5
+
+static char *haystack;
+
+/**
+ * Fill the haystack with characters of alphabet and put needle at the end.
+ */
+static void make_haystack(const char *alphabet, const char *needle,
+                          size_t needle_length) {
+  size_t alphabet_length = strlen(alphabet);
+
+  srand(1);
+  for (size_t i = 0; i < BENCH_BYTES - needle_length; i++) {
+    haystack[i] = alphabet[rand() % alphabet_length];
+  }
+  memcpy(haystack + BENCH_BYTES - needle_length, needle, needle_length);
+}
+
+/**
+ * Make a needle from the alphabet with a character that is not in it at
+ * the middle, so it is only found at the end of the haystack.
+ */
+static void make_needle(char *needle, size_t length, const char *alphabet) {
+  size_t alphabet_length = strlen(alphabet);
+
+  srand(2);
+  for (size_t i = 0; i < length; i++) {
+    needle[i] = alphabet[rand() % alphabet_length];
+  }
+  needle[length / 2] = '#';
+}
+
+static void run(const char *name, const char *alphabet) {
+  static const size_t lengths[] = {1, 4, 16, 32, 64, 256};
+  char needle[BENCH_NEEDLE_MAX];
+  char label[64];
+
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++) {
+    size_t length = lengths[i];
+    string_slice ss = string_slice_make(haystack, BENCH_BYTES);
+    string_slice ss_needle = string_slice_make(needle, length);
+
+    make_needle(needle, length, alphabet);
+    make_haystack(alphabet, needle, length);
+
+    double best_find = 0;
+    double best_memmem = 0;
+    size_t index = 0;
+    const char *found = NULL;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      double start = bench_now();
+      index = string_slice_find(ss, ss_needle);
+      double middle = bench_now();
+      found = memmem(haystack, BENCH_BYTES, needle, length);
+      double end = bench_now();
+
+      if (round == 0 || middle - start < best_find) {
+        best_find = middle - start;
+      }
+      if (round == 0 || end - middle < best_memmem) {
+        best_memmem = end - middle;
+      }
+    }
+
+    snprintf(label, sizeof(label), "%s, find %zu bytes", name, length);
+    printf("  %-40s %10.2f ms\n", label, best_find);
+    snprintf(label, sizeof(label), "%s, memmem %zu bytes", name, length);
+    printf("  %-40s %10.2f ms\n", label, best_memmem);
+
+    if (index != (size_t)(found - haystack)) {
+      printf("  mismatch: %zu != %zu\n", index, (size_t)(found - haystack));
+    }
+  }
+}
+
+int main(void) {
+  haystack = malloc(BENCH_BYTES);
+  printf("string_slice_find, %d bytes\n", BENCH_BYTES);
+
+  run("text", "etaoin shrdlu cmfwyp");
+  run("two letters", "ab");
+
+  free(haystack);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*
+ * Tokenize 8MB of config-file text by lines and by sets of delimiters,
+ * with string_slice and with a byte at a time loop. The tokenizers of a
+ * set take turns and the best of BENCH_ROUNDS runs is kept.
+ */
+
+#include "string_slice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_BYTES (8 << 20)
+#define BENCH_ROUNDS 5
+
+static char *text;
+static size_t text_length;
+
+/**
+ * Fill text with lines like "name_12 = value_345, 678;".
+ */
+static void make_text(void) {
+  text = malloc(BENCH_BYTES + 64);
+  srand(1);
+
+  while (text_length < BENCH_BYTES) {
+    text_length += snprintf(text + text_length, 64,
+                            "name_%d = value_%d, %d;\n", rand() % 1000,
+                            rand() % 100000, rand() % 1000);
+  }
+}
+
+/**
+ * Find the end of a field a byte at a time, like string_slice_split used to.
+ */
+static size_t find_loop(string_slice ss, const char *set, size_t set_length) {
+  size_t index = 0;
+
+  while (index < ss.len &&
+         (set_length == 1 ? ss.ptr[index] != set[0]
+                          : memchr(set, ss.ptr[index], set_length) == NULL)) {
+    index++;
+  }
+
+  return index;
+}
+
+/**
+ * Count the fields ending at any character of set with a search function.
+ */
+static size_t count_fields(size_t (*find)(string_slice, const char *, size_t),
+                           const char *set, size_t set_length) {
+  string_slice ss = string_slice_make(text, text_length);
+  size_t fields = 1;
+  size_t index = 0;
+
+  while ((index = find(ss, set, set_length)) < ss.len) {
+    ss = string_slice_make(ss.ptr + index + 1, ss.len - index - 1);
+    fields++;
+  }
+
+  return fields;
+}
+
+static size_t count_split(void) {
+  string_slice ss = string_slice_make(text, text_length);
+  string_slice line;
+  size_t fields = 0;
+
+  while (string_slice_split(&ss, &line, '\n') == 0) {
+    fields++;
+  }
+
+  return fields;
+}
+
+static size_t count_iter(const char *set, size_t set_length) {
+  string_slice_iter it;
+  string_slice field;
+  size_t fields = 0;
+
+  string_slice_iter_init(&it, string_slice_make(text, text_length), set,
+                         set_length);
+  while (string_slice_iter_next(&it, &field) == 0) {
+    fields++;
+  }
+
+  return fields;
+}
+
+/**
+ * Print the time and throughput of a tokenizer.
+ */
+static void report(const char *name, double ms, size_t fields) {
+  printf("  %-40s %10.2f ms %8.0f MB/s %8zu fields\n", name, ms,
+         text_length / 1e3 / ms, fields);
+}
+
+/**
+ * Keep the shorter of best and the time since start.
+ */
+static double keep_best(int round, double best, double start) {
+  double ms = bench_now() - start;
+
+  return round == 0 || ms < best ? ms : best;
+}
+
+int main(void) {
+  // The last set is as large as the one before but only '\n' occurs in
+  // the text, its fields are whole lines.
+  static const char *sets[] = {"\n", " ,;\n", " \t\n\r,;=:[]{}\"#",
+                               "\n\r\t\"#[]{}<>|!"};
+  double start = 0;
+  size_t fields = 0;
+
+  make_text();
+  printf("string_slice split, %zu bytes\n", text_length);
+
+  start = bench_now();
+  fields = count_split();
+  report("string_slice_split, lines", bench_now() - start, fields);
+
+  for (size_t i = 0; i < sizeof(sets) / sizeof(*sets); i++) {
+    size_t set_length = strlen(sets[i]);
+    double best[3] = {0};
+    size_t counts[3] = {0};
+    char name[64];
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      start = bench_now();
+      counts[0] = count_fields(find_loop, sets[i], set_length);
+      best[0] = keep_best(round, best[0], start);
+
+      start = bench_now();
+      counts[1] = count_fields(string_slice_find_any, sets[i], set_length);
+      best[1] = keep_best(round, best[1], start);
+
+      start = bench_now();
+      counts[2] = count_iter(sets[i], set_length);
+      best[2] = keep_best(round, best[2], start);
+    }
+
+    snprintf(name, sizeof(name), "byte loop, %zu delimiters", set_length);
+    report(name, best[0], counts[0]);
+    snprintf(name, sizeof(name), "find_any, %zu delimiters", set_length);
+    report(name, best[1], counts[1]);
+    snprintf(name, sizeof(name), "string_slice_iter, %zu delimiters",
+             set_length);
+    report(name, best[2], counts[2]);
+  }
+
+  free(text);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/*
+ * Validate 16MB of UTF-8 text, from plain ASCII to only three byte
+ * characters.
+ */
+
+#include "string_slice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_BYTES (16 << 20)
+#define BENCH_ROUNDS 4
+
+/**
+ * Fill a buffer with words built from the given characters, separated by
+ * spaces.
+ *
+ * @param characters characters to pick from.
+ * @param count number of characters.
+ */
+static char *make_text(const char **characters, int count) {
+  char *text = malloc(BENCH_BYTES);
+  size_t length = 0;
+
+  srand(1);
+
+  // Room is left for the longest character and a space.
+  while (length + 5 <= BENCH_BYTES) {
+    const char *character = characters[rand() % count];
+    size_t character_length = strlen(character);
+
+    memcpy(text + length, character, character_length);
+    length += character_length;
+
+    if (rand() % 6 == 0) {
+      text[length++] = ' ';
+    }
+  }
+
+  memset(text + length, ' ', BENCH_BYTES - length);
+
+  return text;
+}
+
+/**
+ * Validate text BENCH_ROUNDS times.
+ */
+static void run(const char *name, const char **characters, int count) {
+  char *text = make_text(characters, count);
+  string_slice ss = string_slice_make(text, BENCH_BYTES);
+  int invalid = 0;
+  double start = bench_now();
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    invalid += string_slice_validate_utf8(ss, NULL) != 0;
+  }
+
+  bench_report(name, start);
+
+  if (invalid != 0) {
+    printf("  %-40s %10d\n", "unexpected invalid rounds", invalid);
+  }
+
+  free(text);
+}
+
+int main(void) {
+  static const char *ascii[] = {"a", "b", "e", "n", "s", "t", "/", "1"};
+  static const char *latin[] = {"a", "b", "e", "n", "s", "t", "\xC3\xA9",
+                                "\xC3\xB6"};
+  static const char *mixed[] = {"a", "\xC3\xA9", "\xD0\xB6", "\xE4\xB8\xAD",
+                                "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+  static const char *cjk[] = {"\xE4\xB8\xAD", "\xE6\x96\x87", "\xE5\xAD\x97",
+                              "\xE7\xAC\xA6"};
+
+  printf("string_slice_validate_utf8, %d x %dMB\n", BENCH_ROUNDS,
+         BENCH_BYTES >> 20);
+
+  run("ascii", ascii, 8);
+  run("latin, 1 in 4 characters accented", latin, 8);
+  run("mixed 1 to 4 byte characters", mixed, 6);
+  run("cjk, 3 byte characters", cjk, 4);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*
+ * Convert 1M numeric arguments to longs, serially and in parallel, on the
+ * shared pool and on pools of 1, 2 and 4 workers. The speedup is bounded
+ * by the number of online CPUs printed first.
+ */
+
+#include "thread_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "dynamic_array.h"
+#include "string_slice.h"
+
+#define BENCH_VALUES 1000000
+
+static void free_str(void **str) { free(str); }
+
+/**
+ * Parse one argument, the way post-parse validation does.
+ */
+static int convert(void *item, void *out, void *ctx) {
+  (void)ctx;
+  size_t error_index = 0;
+
+  return string_slice_to_long(string_slice_from_cstr(*(char **)item), out,
+                              &error_index);
+}
+
+static int convert_at(void *item, unsigned int index, void *ctx) {
+  return convert(item, (long *)ctx + index, NULL);
+}
+
+typedef struct {
+  char **strings;
+  long *values;
+} bench_chunk;
+
+/**
+ * Convert the arguments [begin, end) for thread_pool_parallel_for.
+ */
+static int convert_chunk(unsigned int begin, unsigned int end, void *ctx) {
+  bench_chunk *chunk = ctx;
+  int result = 0;
+
+  for (unsigned int i = begin; i < end; i++) {
+    result |= convert(chunk->strings + i, chunk->values + i, NULL);
+  }
+
+  return result;
+}
+
+/**
+ * Time thread_pool_parallel_for on a pool of num_threads workers.
+ */
+static void run_pool(unsigned int num_threads, bench_chunk *chunk) {
+  thread_pool *pool = NULL;
+  char name[64];
+
+  if (thread_pool_create(&pool, num_threads) != 0) {
+    printf("  cannot start %u threads\n", num_threads);
+    return;
+  }
+
+  double start = bench_now();
+  thread_pool_parallel_for(pool, BENCH_VALUES, 0, convert_chunk, chunk);
+  snprintf(name, sizeof(name), "thread_pool_parallel_for, %u threads",
+           num_threads);
+  bench_report(name, start);
+
+  thread_pool_destroy(&pool);
+}
+
+int main(void) {
+  dynamic_array *array = NULL;
+  dynamic_array *output = NULL;
+  long *values = calloc(BENCH_VALUES, sizeof(long));
+  char value[32];
+  void *item = NULL;
+  double start = 0;
+
+  dynamic_array_create(&array, sizeof(char *), free_str, NULL);
+  srand(1);
+
+  for (unsigned int i = 0; i < BENCH_VALUES; i++) {
+    snprintf(value, sizeof(value), "%ld", (long)rand() * rand());
+    dynamic_array_add_str(array, strdup(value));
+  }
+
+  thread_pool *pool = NULL;
+  thread_pool_get_default(&pool);
+  printf("thread_pool, %d values, %ld online CPUs, %d threads by default\n",
+         BENCH_VALUES, sysconf(_SC_NPROCESSORS_ONLN),
+         thread_pool_get_size(pool));
+
+  start = bench_now();
+  for (unsigned int i = 0; dynamic_array_find_ref(array, i, &item) == 0; i++) {
+    convert(item, values + i, NULL);
+  }
+  bench_report("serial loop", start);
+
+  start = bench_now();
+  dynamic_array_parallel_for(array, convert_at, values, 0);
+  bench_report("parallel_for", start);
+
+  dynamic_array_create(&output, sizeof(long), NULL, NULL);
+  start = bench_now();
+  dynamic_array_parallel_map(array, output, convert, NULL, 0);
+  bench_report("parallel_map", start);
+
+  // The same work on pools of a chosen size, whatever the CPU count.
+  char **strings = malloc(BENCH_VALUES * sizeof(char *));
+  bench_chunk chunk = {.strings = strings, .values = values};
+
+  for (unsigned int i = 0; dynamic_array_find_ref(array, i, &item) == 0; i++) {
+    strings[i] = *(char **)item;
+  }
+
+  for (unsigned int num_threads = 1; num_threads <= 4; num_threads *= 2) {
+    run_pool(num_threads, &chunk);
+  }
+
+  free(strings);
+
+  dynamic_array_destroy(&output);
+  dynamic_array_destroy(&array);
+  free(values);
+
+  return EXIT_SUCCESS;
+}
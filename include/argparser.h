@@ -2,6 +2,9 @@
 #define ARGPARSER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "output_sink.h"
 
 // Optional single input value.
 #define AP_ARG_OPTIONAL "?"
@@ -15,6 +18,10 @@
 // Values are stored in an array.
 #define AP_ARG_REMAINDER "!"
 
+// Returned by argparser_parse_args when -h/--help was passed, after the
+// status codes of logger.h.
+#define AP_HELP_REQUESTED 6
+
 // Parser argument type to convert to
 typedef enum argparser_arg_type {
   AP_ARG_FLOAT,   // Parser convert to float.
@@ -37,6 +44,12 @@ typedef enum argparser_arg_action {
   AP_ARG_STORE_VERSION,       // Print version of program and exit.
 } argparser_arg_action;
 
+// How errors found while parsing are written to the sink.
+typedef enum argparser_diagnostics_format {
+  AP_DIAGNOSTICS_TEXT,  // One 'error: ...' line per error. default format
+  AP_DIAGNOSTICS_JSON,  // One JSON array of error records.
+} argparser_diagnostics_format;
+
 /**
  * Allocate necessary resources and setup.
  *
@@ -115,6 +128,20 @@ int argparser_add_epilogue_to_argparser(argparser **parser, char *epilogue);
  */
 int argparser_add_prechars_to_argparser(argparser **parser, char *prefix_chars);
 
+/**
+ * Add a help message rendered at build time to argparser.
+ *
+ * The message is printed as is for -h/--help instead of being rendered
+ * from the arguments, whatever the terminal width.
+ *
+ * @param parser argparser to modify.
+ * @param static_help complete help message.
+ *
+ * @return 0 on success, 1 indicates static_help is empty.
+ */
+int argparser_add_static_help_to_argparser(argparser **parser,
+                                           const char *static_help);
+
 /**
  * Add help to argparser.
  *
@@ -137,6 +164,57 @@ int argparser_add_help_to_argparser(argparser **parser, bool help);
  */
 int argparser_add_abbrev_to_argparser(argparser **parser, bool allow_abbrev);
 
+/**
+ * Add strict UTF-8 checking to argparser.
+ *
+ * When enabled every command line argument must be well formed UTF-8, an
+ * argument that is not is reported as an error when parsing.
+ *
+ * @param parser argparser to modify.
+ * @param strict_utf8 Reject arguments that are not valid UTF-8.
+ *                    valid values are 'AP_FALSE' and  'AP_TRUE'
+ *
+ * @return 0 on success, 1 indicates invalid 'strict_utf8' value.
+ */
+int argparser_add_strict_utf8_to_argparser(argparser **parser,
+                                           bool strict_utf8);
+
+/**
+ * Add output sink to argparser.
+ *
+ * Errors are rendered into the sink and flushed once parsing is done.
+ * By default they are written to stderr.
+ *
+ * @param parser argparser to modify.
+ * @param sink where to write errors. The caller keeps ownership and must
+ *             keep it alive until the parser is destroyed.
+ *
+ * @return 0 on success, 5 indicates sink is NULL.
+ */
+int argparser_add_sink_to_argparser(argparser **parser, output_sink *sink);
+
+/**
+ * Add diagnostics format to argparser.
+ *
+ * In JSON format the errors of a parse are written as a single line holding
+ * a compact array of records, each one an object with the members:
+ *   "code"     one of "expected_argument", "invalid_value", "out_of_range",
+ *              "invalid_utf8", "unrecognized_argument" or
+ *              "missing_required".
+ *   "argument" argument the error is about(e.g. "-a/--all"), or null.
+ *   "token"    index in argv where the error was found, or null.
+ *   "message"  human readable description of the error.
+ * Nothing is written when there are no errors.
+ *
+ * @param parser argparser to modify.
+ * @param format valid values are 'AP_DIAGNOSTICS_TEXT' and
+ *               'AP_DIAGNOSTICS_JSON'
+ *
+ * @return 0 on success, 1 indicates invalid 'format' value.
+ */
+int argparser_add_diagnostics_format_to_argparser(
+    argparser **parser, argparser_diagnostics_format format);
+
 /**
  * Add argument to the parser.
  *
@@ -378,14 +456,83 @@ int argparser_add_const_value_to_arg(argparser *parser, char *name_or_flag,
 int argparser_add_choices_to_arg(argparser *parser, char *name_or_flag,
                                  char *choices);
 
+/**
+ * Get the help message.
+ *
+ * Arguments are listed in the order they were added, help text is aligned
+ * in a second column and wrapped to the given width. The message is
+ * rendered once and cached by the parser until the parser is changed or a
+ * different width is asked for.
+ *
+ * @param parser argparser to access.
+ * @param width number of columns to wrap to, 0 uses the terminal width
+ *              (COLUMNS, then the width of stdout, then 80).
+ * @param help where to store the message. It stays valid until the parser
+ *             is changed, asked for another width or destroyed.
+ * @param length where to store the number of characters in help.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates parser, help or length is NULL.
+ */
+int argparser_get_help(argparser *parser, unsigned int width,
+                       const char **help, size_t *length);
+
+/**
+ * Format the help message into a new string.
+ *
+ * See argparser_get_help.
+ *
+ * @param parser argparser to access.
+ * @param width number of columns to wrap to, 0 uses the terminal width
+ *              (COLUMNS, then the width of stdout, then 80).
+ * @param help where to store the message. The caller is responsible for
+ *             deallocating it.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates parser or help is NULL.
+ */
+int argparser_format_help(argparser *parser, unsigned int width,
+                          char **help);
+
+/**
+ * Print the help message in a single write.
+ *
+ * @param parser argparser to access.
+ * @param sink where to write the message, NULL writes to stdout.
+ *
+ * @return 0 on success,
+ *         1 indicates writing failed,
+ *         2 indicates memory allocation failed,
+ *         5 indicates parser is NULL.
+ */
+int argparser_print_help(argparser *parser, output_sink *sink);
+
 /**
  * Parse parser arguments.
  *
+ * When add_help is set and -h/--help is passed as an option(before any
+ * "--" and not added as an argument), nothing is printed and
+ * AP_HELP_REQUESTED is returned. Printing the help and exiting is left to
+ * the caller.
+ *
  * @param parser argparser to parse.
  * @param argc argument count.
  * @param argv array of arguments as strings.
  *
- * @return 0 on success, positive number otherwise.
+ * @example
+ *   int status = argparser_parse_args(parser, argc, argv);
+ *
+ *   if (status == AP_HELP_REQUESTED) {
+ *     argparser_print_help(parser, NULL);
+ *     argparser_destroy(&parser);
+ *     return EXIT_SUCCESS;
+ *   }
+ *
+ * @return 0 on success,
+ *         6(AP_HELP_REQUESTED) indicates -h/--help was passed,
+ *         positive number otherwise.
  */
 int argparser_parse_args(argparser *parser, int argc, char *argv[]);
 /**
@@ -0,0 +1,175 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+/*
+ * Set of bits stored in 64 bit words.
+ *
+ * Set operations work a word at a time. A fixed bitset rejects indices past
+ * its size, a growable bitset grows to fit them.
+ */
+
+typedef struct bitset bitset;
+
+/**
+ * Allocate necessary resources and setup a bitset that cannot grow.
+ *
+ * @param bs bitset to create.
+ * @param num_bits number of bits, all cleared.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int bitset_create(bitset **bs, unsigned int num_bits);
+
+/**
+ * Allocate necessary resources and setup a bitset that grows as bits are
+ * set past its size.
+ *
+ * @param bs bitset to create.
+ * @param num_bits initial number of bits, all cleared.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int bitset_create_growable(bitset **bs, unsigned int num_bits);
+
+/**
+ * Retrieve the number of bits in the bitset.
+ *
+ * @param bs the bitset to access.
+ *
+ * @return -1 indicates bs is NULL, positive number otherwise.
+ */
+int bitset_get_size(bitset *bs);
+
+/**
+ * Set the bit at a given index.
+ *
+ * @param bs bitset to modify.
+ * @param index bit to set.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates index is out of bounds of a fixed bitset,
+ *         5 indicates bs is NULL.
+ */
+int bitset_set(bitset *bs, unsigned int index);
+
+/**
+ * Clear the bit at a given index.
+ *
+ * @param bs bitset to modify.
+ * @param index bit to clear.
+ *
+ * @return 0 on success,
+ *         4 indicates index is out of bounds,
+ *         5 indicates bs is NULL.
+ */
+int bitset_clear(bitset *bs, unsigned int index);
+
+/**
+ * Check the bit at a given index.
+ *
+ * @param bs bitset to access.
+ * @param index bit to check.
+ *
+ * @return 1 if the bit is set, 0 otherwise(including out of bounds).
+ */
+int bitset_test(bitset *bs, unsigned int index);
+
+/**
+ * Clear every bit.
+ *
+ * @param bs bitset to modify.
+ */
+void bitset_clear_all(bitset *bs);
+
+/**
+ * Set every bit of dest that is set in src (dest |= src).
+ *
+ * A growable dest grows to the size of src. Otherwise bits past the size of
+ * dest are ignored.
+ *
+ * @param dest bitset to modify.
+ * @param src bitset to access.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates dest or src is NULL.
+ */
+int bitset_or(bitset *dest, bitset *src);
+
+/**
+ * Clear every bit of dest that is not set in src (dest &= src).
+ *
+ * @param dest bitset to modify.
+ * @param src bitset to access.
+ *
+ * @return 0 on success, 5 indicates dest or src is NULL.
+ */
+int bitset_and(bitset *dest, bitset *src);
+
+/**
+ * Clear every bit of dest that is set in src (dest &= ~src).
+ *
+ * @param dest bitset to modify.
+ * @param src bitset to access.
+ *
+ * @return 0 on success, 5 indicates dest or src is NULL.
+ */
+int bitset_andnot(bitset *dest, bitset *src);
+
+/**
+ * Count the bits that are set.
+ *
+ * @param bs bitset to access.
+ *
+ * @return number of bits set, 0 if bs is NULL.
+ */
+unsigned int bitset_count(bitset *bs);
+
+/**
+ * Check if both bitsets have a bit set in common.
+ *
+ * @param a bitset to access.
+ * @param b bitset to access.
+ *
+ * @return 1 if a and b share a set bit, 0 otherwise.
+ */
+int bitset_intersects(bitset *a, bitset *b);
+
+/**
+ * Check if every bit set in a is also set in b.
+ *
+ * @param a bitset to access.
+ * @param b bitset to access.
+ *
+ * @return 1 if a is a subset of b, 0 otherwise.
+ */
+int bitset_is_subset(bitset *a, bitset *b);
+
+/**
+ * Find the first set bit at or after a given index.
+ *
+ * @param bs bitset to access.
+ * @param start index to start searching from.
+ * @param index where to store the position of the bit.
+ *
+ * @example
+ *   ...
+ *   for (unsigned int i = 0; bitset_find_first(bs, i, &i) == 0; i++) {
+ *     // Do Work
+ *   }
+ *
+ * @return 0 on success,
+ *         1 indicates no bit is set,
+ *         5 indicates bs is NULL.
+ */
+int bitset_find_first(bitset *bs, unsigned int start, unsigned int *index);
+
+/**
+ * Deallocate and set to NULL.
+ *
+ * @param bs bitset to deallocate.
+ */
+void bitset_destroy(bitset **bs);
+
+#endif  // BITSET_H
@@ -10,7 +10,8 @@ typedef struct dynamic_array_iter dynamic_array_iter;
  * @param array dynamic_array to create.
  * @param data_size Size in bytes of each value stored.
  * @param freefn Function used to deallocate user defined structure.
- * @param matchfn Function used to find a user defined struture.
+ * @param matchfn Function used to find a user defined struture. Returns 0
+ *                when both elements match, negative/positive to order them.
  *
  * @return 0 on success, 2 indicates memory allocation failed.
  */
@@ -138,6 +139,185 @@ int dynamic_array_remove(dynamic_array *array, unsigned int index);
  */
 int dynamic_array_shrink_to_fit(dynamic_array *array);
 
+/**
+ * Sort the elements of the array in place.
+ *
+ * Uses introsort: quicksort with a median of three pivot, falling back to
+ * heapsort when the recursion gets too deep and to insertion sort for small
+ * ranges.
+ *
+ * @param array dynamic_array to modify.
+ * @param cmpfn Function that receives references to two elements and returns
+ *              a negative number, 0 or a positive number. If NULL, the
+ *              array's matchfn is used.
+ *
+ * @return 0 on success,
+ *         1 indicates there is no function to compare elements,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_sort(dynamic_array *array, int (*cmpfn)(void *, void *));
+
+/**
+ * Sort an array of strings in place.
+ *
+ * NOTE: Only for arrays populated with 'dynamic_array_add_str'.
+ *       Uses MSD radix sort on 8 characters at a time so strings are never
+ *       compared as a whole.
+ *
+ * @param array dynamic_array to modify.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_sort_str(dynamic_array *array);
+
+/**
+ * Sort an array of strings in place and remove duplicates.
+ *
+ * Same as 'dynamic_array_sort_str' followed by 'dynamic_array_unique_str',
+ * but duplicates are found while sorting, without comparing neighbours
+ * again. Removed strings are deallocated with the array's freefn, in
+ * address order.
+ *
+ * NOTE: Only for arrays populated with 'dynamic_array_add_str'.
+ *       Every string is read once per 8 characters it shares with another
+ *       one, strings with long common prefixes(e.g. paths) are the slowest.
+ *
+ * @param array dynamic_array to modify.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_sort_unique_str(dynamic_array *array);
+
+/**
+ * Sort an array of long integers in place.
+ *
+ * Uses LSD radix sort, skipping every byte all the elements share.
+ *
+ * @param array dynamic_array to modify. 'data_size' MUST be sizeof(long).
+ *
+ * @return 0 on success,
+ *         1 indicates the elements are not long integers,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_sort_long(dynamic_array *array);
+
+/**
+ * Search a sorted array for an element.
+ *
+ * @param array dynamic_array to search.
+ * @param key reference to the value to search for.
+ * @param cmpfn Function used to sort the array. If NULL, the array's
+ *              matchfn is used.
+ * @param index where to store the position of the element. If the element is
+ *              not found, the position it would be inserted at.
+ *
+ * @return 0 on success,
+ *         1 indicates the element was not found,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_bsearch(dynamic_array *array, const void *key,
+                          int (*cmpfn)(void *, void *), unsigned int *index);
+
+/**
+ * Remove consecutive duplicate elements, keeping the first one.
+ *
+ * Sort the array first to remove every duplicate. Removed elements are
+ * deallocated with the array's freefn.
+ *
+ * @param array dynamic_array to modify.
+ * @param cmpfn Function that returns 0 when two elements are equal. If NULL,
+ *              the array's matchfn is used.
+ *
+ * @return 0 on success,
+ *         1 indicates there is no function to compare elements,
+ *         5 indicates array is NULL.
+ */
+int dynamic_array_unique(dynamic_array *array, int (*cmpfn)(void *, void *));
+
+/**
+ * Remove consecutive duplicate strings, keeping the first one.
+ *
+ * Removed strings are deallocated with the array's freefn, in address
+ * order when there is memory to sort them.
+ *
+ * NOTE: Only for arrays populated with 'dynamic_array_add_str'.
+ *
+ * @param array dynamic_array to modify.
+ *
+ * @return 0 on success, 5 indicates array is NULL.
+ */
+int dynamic_array_unique_str(dynamic_array *array);
+
+/**
+ * Find the position of the first element equal to item.
+ *
+ * Elements are compared with the array's matchfn when defined. Otherwise
+ * they are compared byte by byte, several elements at a time for 1, 4 and 8
+ * byte elements.
+ *
+ * @param array dynamic_array to search.
+ * @param item reference to the value to search for.
+ * @param index where to store the position of the element.
+ *
+ * @return 0 on success,
+ *         1 indicates the element was not found,
+ *         5 indicates array or item is NULL.
+ */
+int dynamic_array_index_of(dynamic_array *array, const void *item,
+                           unsigned int *index);
+
+/**
+ * Call a function on every element, splitting the work across threads.
+ *
+ * Runs on the library's shared thread pool. Elements are visited in no
+ * particular order, fn MUST be safe to call from several threads at once.
+ *
+ * @param array dynamic_array to access.
+ * @param fn Function that receives a reference to an element, its index and
+ *           ctx. A non 0 return value marks the call as failed.
+ * @param ctx user data passed to fn.
+ * @param grain number of elements handed to a thread at a time. If 0, one
+ *              is picked from the size of the array.
+ *
+ * @return 0 on success,
+ *         1 indicates fn failed for at least one element,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array or fn is NULL.
+ */
+int dynamic_array_parallel_for(dynamic_array *array,
+                               int (*fn)(void *item, unsigned int index,
+                                         void *ctx),
+                               void *ctx, unsigned int grain);
+
+/**
+ * Transform every element into a new element of output, in parallel.
+ *
+ * Results are appended to output in the same order as the elements of
+ * array, regardless of which thread produced them.
+ *
+ * @param array dynamic_array to access.
+ * @param output dynamic_array to append the results to.
+ * @param fn Function that receives a reference to an element, a reference to
+ *           the zeroed output element to fill in and ctx. A non 0 return
+ *           value marks the call as failed.
+ * @param ctx user data passed to fn.
+ * @param grain number of elements handed to a thread at a time. If 0, one
+ *              is picked from the size of the array.
+ *
+ * @return 0 on success,
+ *         1 indicates fn failed for at least one element,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array, output or fn is NULL.
+ */
+int dynamic_array_parallel_map(dynamic_array *array, dynamic_array *output,
+                               int (*fn)(void *item, void *out, void *ctx),
+                               void *ctx, unsigned int grain);
+
 /**
  * Deallocate and set to NULL.
  *
@@ -45,6 +45,24 @@ int hash_table_get_size(hash_table *ht);
  */
 int hash_table_insert(hash_table *ht, const char *key, const void *value);
 
+/**
+ * Insert an entry to the hash table using the first 'key_length'
+ * characters of key.
+ *
+ * Same as 'hash_table_insert', key does not need to be null terminated.
+ *
+ * @param ht hash table to be modified.
+ * @param key identifier used to access the data stored.
+ * @param key_length number of characters in key.
+ * @param value item to insert.
+ *
+ * @return 0 on success,
+ *         1 indicates cannot update existing entry.
+ *         5 indicates hash table is NULL.
+ */
+int hash_table_insert_n(hash_table *ht, const char *key,
+                        unsigned int key_length, const void *value);
+
 /**
  * Insert/Update an entry to the hash table.
  *
@@ -75,6 +93,26 @@ int hash_table_insert_and_replace(hash_table *ht, const char *key, void *value);
  */
 int hash_table_search(hash_table *ht, const char *key, void **value);
 
+/**
+ * Search for an entry in the hash table using the first 'key_length'
+ * characters of key.
+ *
+ * Same as 'hash_table_search', key does not need to be null terminated so
+ * a slice of a larger string can be looked up without copying it.
+ *
+ * @param ht hash table to be modified.
+ * @param key identifier used to access the hash table entry.
+ * @param key_length number of characters in key.
+ * @param value pointer used to get a reference to the entry's value.
+ *
+ * @return 0 on success, value is set to NULL if key if not found ,
+ *         1 indicates key was not found,
+ *         3 indicates ht is empty,
+ *         5 indicates hash table is NULL.
+ */
+int hash_table_search_n(hash_table *ht, const char *key,
+                        unsigned int key_length, void **value);
+
 /**
  * Delete an entry from the hash table.
  *
@@ -0,0 +1,163 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+/*
+ * Streaming JSON written straight into a string_builder.
+ *
+ * Values are written in order as the document is walked, nothing is kept
+ * in memory besides the nesting. Commas and colons are added by the
+ * writer, output is compact(no whitespace).
+ *
+ * Strings are expected to be UTF-8, every byte that is not part of a valid
+ * sequence is written as \ufffd so the document stays valid.
+ */
+
+#include <stddef.h>
+
+#include "string_builder.h"
+
+// Deepest nesting of arrays and objects, one bit of has_values per depth.
+#define JSON_WRITER_MAX_DEPTH 31
+
+typedef struct json_writer {
+  string_builder *sb;       // Where the document is written.
+  unsigned int depth;       // Number of open arrays and objects.
+  unsigned int has_values;  // Bit per depth, set once a value is in.
+  char after_key;           // A key was written, its value is next.
+} json_writer;
+
+/**
+ * Setup a json_writer that appends to a string_builder.
+ *
+ * @param jw json_writer to setup.
+ * @param sb string_builder to append to, owned by the caller.
+ *
+ * @example
+ *   json_writer jw;
+ *
+ *   json_writer_init(&jw, &sb);
+ *   json_writer_begin_object(&jw);
+ *   json_writer_key(&jw, "code", 4);
+ *   json_writer_long(&jw, 2);
+ *   json_writer_end_object(&jw);
+ */
+void json_writer_init(json_writer *jw, string_builder *sb);
+
+/**
+ * Open an array.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates nesting is deeper than JSON_WRITER_MAX_DEPTH.
+ */
+int json_writer_begin_array(json_writer *jw);
+
+/**
+ * Close the innermost array.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         3 indicates nothing is open.
+ */
+int json_writer_end_array(json_writer *jw);
+
+/**
+ * Open an object.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates nesting is deeper than JSON_WRITER_MAX_DEPTH.
+ */
+int json_writer_begin_object(json_writer *jw);
+
+/**
+ * Close the innermost object.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         3 indicates nothing is open.
+ */
+int json_writer_end_object(json_writer *jw);
+
+/**
+ * Write the key of the next member of an object.
+ *
+ * @param jw json_writer to write to.
+ * @param key name of the member, escaped as needed.
+ * @param length number of characters in key.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_key(json_writer *jw, const char *key, size_t length);
+
+/**
+ * Write a string value.
+ *
+ * @param jw json_writer to write to.
+ * @param str characters of the string, escaped as needed.
+ * @param length number of characters in str.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_string(json_writer *jw, const char *str, size_t length);
+
+/**
+ * Start a string value written in several parts.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_begin_string(json_writer *jw);
+
+/**
+ * Add characters to the string started with json_writer_begin_string.
+ *
+ * NOTE: A UTF-8 sequence split across two calls is written as \ufffd.
+ *
+ * @param jw json_writer to write to.
+ * @param str characters to add, escaped as needed.
+ * @param length number of characters in str.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_append_string(json_writer *jw, const char *str,
+                              size_t length);
+
+/**
+ * Finish the string started with json_writer_begin_string.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_end_string(json_writer *jw);
+
+/**
+ * Write an integer value.
+ *
+ * @param jw json_writer to write to.
+ * @param value number to write.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_long(json_writer *jw, long value);
+
+/**
+ * Write a null value.
+ *
+ * @param jw json_writer to write to.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int json_writer_null(json_writer *jw);
+
+#endif  // JSON_WRITER_H
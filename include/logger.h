@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+#include <stdio.h>
+
 enum status_codes {
   STATUS_SUCCESS,
   STATUS_FAILURE,
@@ -15,20 +18,91 @@ enum status_codes {
 #define TERMINAL_YELLOW "\033[33m"
 #define TERMINAL_RESET "\033[0m"
 
-#define LOG_ERROR(format, ...)                                          \
-  fprintf(stderr, TERMINAL_RED "error" TERMINAL_RESET ": " format "\n", \
-          ##__VA_ARGS__)
+/*
+ * Log levels, a message is kept when its level is at most LOG_LEVEL.
+ */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Set with -DLOG_LEVEL=..., release(NDEBUG) builds drop info and debug.
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL LOG_LEVEL_WARN
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+/**
+ * Format a message and hand it to the log sink.
+ *
+ * Use the LOG_* macros instead, they compile to nothing below LOG_LEVEL.
+ *
+ * @param level one of LOG_LEVEL_ERROR, LOG_LEVEL_WARN, LOG_LEVEL_INFO or
+ *              LOG_LEVEL_DEBUG.
+ * @param format printf style format.
+ * @param ... variable number of arguments.
+ */
+void logger_log(int level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Send log messages to a function instead of stderr.
+ *
+ * @param sink function receiving every message as one line(prefix and
+ *             trailing newline included, never colored), NULL restores
+ *             stderr.
+ * @param ctx passed to sink as is.
+ */
+void logger_set_sink(void (*sink)(int level, const char *message,
+                                  size_t length, void *ctx),
+                     void *ctx);
+
+/**
+ * Check if messages should be colored, which is when stderr is a
+ * terminal. isatty is only called the first time.
+ *
+ * @return 1 if colored, 0 otherwise.
+ */
+int logger_use_colors(void);
+
+// Disabled levels keep the call in dead code so the format and arguments
+// are still checked, but nothing is evaluated or emitted.
+#define LOG_DISABLED(format, ...)             \
+  do {                                        \
+    if (0) {                                  \
+      fprintf(stderr, format, ##__VA_ARGS__); \
+    }                                         \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) \
+  logger_log(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) LOG_DISABLED(format, ##__VA_ARGS__)
+#endif
 
-#define LOG_WARN(format, ...)                                                \
-  fprintf(stderr, TERMINAL_YELLOW "warning" TERMINAL_RESET ": " format "\n", \
-          ##__VA_ARGS__)
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) logger_log(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) LOG_DISABLED(format, ##__VA_ARGS__)
+#endif
 
-#define LOG_INFO(format, ...)                                           \
-  fprintf(stderr, TERMINAL_BLUE "info" TERMINAL_RESET ": " format "\n", \
-          ##__VA_ARGS__)
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) logger_log(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) LOG_DISABLED(format, ##__VA_ARGS__)
+#endif
 
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
 #define LOG_DEBUG(format, ...) \
-  fprintf(stderr, "debug: " format "\n", ##__VA_ARGS__)
+  logger_log(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) LOG_DISABLED(format, ##__VA_ARGS__)
+#endif
 
 #define RETURN_DEFER(s) \
   do {                  \
@@ -0,0 +1,131 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+/*
+ * Destination for rendered text such as help, usage and errors.
+ *
+ * A sink writes to a FILE*, to a file descriptor through an internal
+ * buffer, to a caller owned string_builder or to a callback. Text is
+ * handed over with output_sink_write and delivered no later than
+ * output_sink_flush. Text made of several pieces can be handed over at
+ * once with output_sink_writev, a file descriptor sink then writes them
+ * with writev instead of copying them into its buffer.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+#include "string_builder.h"
+
+typedef struct output_sink output_sink;
+
+/**
+ * Allocate a sink writing to a stream.
+ *
+ * Buffering is left to the stream, flushing calls fflush.
+ *
+ * @param sink output_sink to create.
+ * @param file stream to write to, not closed on destroy.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates file is NULL.
+ */
+int output_sink_create_file(output_sink **sink, FILE *file);
+
+/**
+ * Allocate a sink writing to a file descriptor.
+ *
+ * Text is buffered and written with a single write per flush(or when the
+ * buffer fills up).
+ *
+ * @param sink output_sink to create.
+ * @param fd file descriptor to write to, not closed on destroy.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int output_sink_create_fd(output_sink **sink, int fd);
+
+/**
+ * Allocate a sink appending to a string_builder.
+ *
+ * @param sink output_sink to create.
+ * @param buffer string_builder to append to, owned by the caller.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates buffer is NULL.
+ */
+int output_sink_create_memory(output_sink **sink, string_builder *buffer);
+
+/**
+ * Allocate a sink handing text to a function.
+ *
+ * Text is buffered, fn is called once per flush(or when the buffer fills
+ * up) with everything written since the last call.
+ *
+ * @param sink output_sink to create.
+ * @param fn function receiving the text, returns 0 on success.
+ * @param ctx passed to fn as is.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates fn is NULL.
+ */
+int output_sink_create_callback(output_sink **sink,
+                                int (*fn)(const char *data, size_t length,
+                                          void *ctx),
+                                void *ctx);
+
+/**
+ * Write text to the sink.
+ *
+ * @param sink output_sink to write to.
+ * @param data text to write.
+ * @param length number of characters in data.
+ *
+ * @return 0 on success,
+ *         1 indicates writing failed,
+ *         2 indicates memory allocation failed,
+ *         5 indicates sink or data is NULL.
+ */
+int output_sink_write(output_sink *sink, const char *data, size_t length);
+
+/**
+ * Write several pieces of text to the sink, in order.
+ *
+ * A file descriptor sink writes anything it buffered followed by the pieces
+ * with writev, without copying them, so they are delivered on return.
+ * Other sinks copy the pieces as output_sink_write does.
+ *
+ * @param sink output_sink to write to.
+ * @param iov pieces of text to write.
+ * @param count number of pieces in iov.
+ *
+ * @return 0 on success,
+ *         1 indicates writing failed,
+ *         2 indicates memory allocation failed,
+ *         5 indicates sink or iov is NULL.
+ */
+int output_sink_writev(output_sink *sink, const struct iovec *iov, int count);
+
+/**
+ * Deliver everything written so far.
+ *
+ * @param sink output_sink to flush.
+ *
+ * @return 0 on success,
+ *         1 indicates writing failed,
+ *         5 indicates sink is NULL.
+ */
+int output_sink_flush(output_sink *sink);
+
+/**
+ * Flush, deallocate and set to NULL.
+ *
+ * @param sink output_sink to deallocate.
+ */
+void output_sink_destroy(output_sink **sink);
+
+#endif  // OUTPUT_SINK_H
@@ -0,0 +1,110 @@
+#ifndef SEGMENTED_ARRAY_H
+#define SEGMENTED_ARRAY_H
+
+/*
+ * Growable array made of segments that double in size.
+ *
+ * Existing segments are never reallocated, so references to elements stay
+ * valid until the array is destroyed and growing never copies elements.
+ */
+
+typedef struct segmented_array segmented_array;
+
+/**
+ * Allocate necessary resources and setup.
+ *
+ * @param array segmented_array to create.
+ * @param data_size Size in bytes of each value stored.
+ * @param freefn Function used to deallocate user defined structure.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int segmented_array_create(segmented_array **array, unsigned int data_size,
+                           void (*freefn)(void **));
+
+/**
+ * Add a new element to the array.
+ *
+ * @param array segmented_array to modify.
+ * @param item the element to add.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates array is full,
+ *         5 indicates array or item is NULL.
+ */
+int segmented_array_add(segmented_array *array, const void *item);
+
+/**
+ * Add a new string to the array.
+ *
+ * NOTE: The pointer is stored, the string is not copied.
+ *
+ * @param array segmented_array to modify.
+ * @param str the string to add.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates array is full,
+ *         5 indicates array or str is NULL.
+ */
+int segmented_array_add_str(segmented_array *array, const char *str);
+
+/**
+ * Get a reference to the element at a given index.
+ *
+ * The reference stays valid while elements are added.
+ *
+ * @param array segmented_array to access.
+ * @param index Index to access.
+ * @param item Where to store the reference.
+ *
+ * @return 0 on success,
+ *         3 indicates array is empty,
+ *         4 indicates index is out of bounds,
+ *         5 indicates array is NULL.
+ */
+int segmented_array_find_ref(segmented_array *array, unsigned int index,
+                             void **item);
+
+/**
+ * Get the string at a given index.
+ *
+ * @param array segmented_array to access.
+ * @param index Index to access.
+ * @param str Where to store the string.
+ *
+ * @return 0 on success,
+ *         3 indicates array is empty,
+ *         4 indicates index is out of bounds,
+ *         5 indicates array is NULL.
+ */
+int segmented_array_find_ref_str(segmented_array *array, unsigned int index,
+                                 char **str);
+
+/**
+ * Retrive the number of elements in the array.
+ *
+ * @param array the array to access.
+ *
+ * @return -1 indicates array is NULL, positive number otherwise.
+ */
+int segmented_array_get_size(segmented_array *array);
+
+/**
+ * Check if array is empty.
+ *
+ * @param array segmented_array to check.
+ *
+ * @return 1 if empty, 0 otherwise.
+ */
+int segmented_array_is_empty(segmented_array *array);
+
+/**
+ * Deallocate and set to NULL.
+ *
+ * @param array segmented_array to deallocate.
+ */
+void segmented_array_destroy(segmented_array **array);
+
+#endif  // SEGMENTED_ARRAY_H
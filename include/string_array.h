@@ -0,0 +1,98 @@
+#ifndef STRING_ARRAY_H
+#define STRING_ARRAY_H
+
+/*
+ * Array of strings packed into a single buffer.
+ *
+ * Every string is copied, with its null byte, to the end of one growing
+ * buffer. A table of offsets and lengths locates each string. Adding a
+ * string is a single copy and the whole array is deallocated at once.
+ */
+
+typedef struct string_array string_array;
+
+/**
+ * Allocate necessary resources and setup.
+ *
+ * @param array string_array to create.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+int string_array_create(string_array **array);
+
+/**
+ * Add a copy of a string to the end of the array.
+ *
+ * NOTE: Strings previously retrieved with 'string_array_get' may be moved.
+ *
+ * @param array string_array to modify.
+ * @param str string to add, does not need to be null terminated.
+ * @param length number of characters in str.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array or str is NULL.
+ */
+int string_array_append(string_array *array, const char *str,
+                        unsigned int length);
+
+/**
+ * Get the string at a given index.
+ *
+ * @param array string_array to access.
+ * @param index Index to access.
+ * @param str Where to store the null terminated string. Valid until the
+ *            next string is added.
+ * @param length Where to store the number of characters in str. Ignored if
+ *               NULL.
+ *
+ * @return 0 on success,
+ *         3 indicates array is empty,
+ *         4 indicates index is out of bounds,
+ *         5 indicates array is NULL.
+ */
+int string_array_get(string_array *array, unsigned int index, const char **str,
+                     unsigned int *length);
+
+/**
+ * Remove every duplicate string, keeping the first one.
+ *
+ * The order of the strings kept is preserved and they are packed again at
+ * the start of the buffer. Strings are found with a hash table, every one
+ * is read once to hash it and compared to another only when their hashes
+ * match.
+ *
+ * NOTE: Strings previously retrieved with 'string_array_get' may be moved.
+ *
+ * @param array string_array to modify.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         5 indicates array is NULL.
+ */
+int string_array_dedup(string_array *array);
+
+/**
+ * Retrive the number of strings in the array.
+ *
+ * @param array the array to access.
+ *
+ * @return -1 indicates array is NULL, positive number otherwise.
+ */
+int string_array_get_size(string_array *array);
+
+/**
+ * Remove every string, keeping the memory for reuse.
+ *
+ * @param array string_array to modify.
+ */
+void string_array_clear(string_array *array);
+
+/**
+ * Deallocate and set to NULL.
+ *
+ * @param array string_array to deallocate.
+ */
+void string_array_destroy(string_array **array);
+
+#endif  // STRING_ARRAY_H
@@ -2,14 +2,29 @@
 #define STRING_BUILDER_H
 
 /*
- * Dynamic string implemented using dynamic array.
+ * Dynamic string stored in a single growing buffer.
  *
- * Creates a string character by character.
+ * Creates a string character by character. Appending is inlined, only
+ * growing the buffer goes through a function call.
+ *
+ * A builder can also live on the stack over a caller supplied buffer, it
+ * only moves to the heap once the text outgrows that buffer.
  */
 
-#include "dynamic_array.h"
+#include <stddef.h>
+#include <string.h>
+
+#include "logger.h"
+
+// Size of a stack buffer that fits most messages.
+#define STRING_BUILDER_STACK_CAPACITY 256
 
-typedef struct string_builder string_builder;
+typedef struct string_builder {
+  char *data;       // Characters being built, not null terminated.
+  size_t length;    // Number of characters in data.
+  size_t capacity;  // Bytes allocated for data.
+  char borrowed;    // data belongs to the caller, never freed or resized.
+} string_builder;
 
 /**
  * Allocate necessary resources and setup.
@@ -20,6 +35,68 @@ typedef struct string_builder string_builder;
  */
 int string_builder_create(string_builder **sb);
 
+/**
+ * Setup a string_builder that was not allocated with string_builder_create.
+ *
+ * Characters are written to 'buffer' until it is full, then they are moved
+ * to memory owned by the builder.
+ *
+ * @param sb string_builder to setup.
+ * @param buffer memory to use first, may be NULL. It must outlive the
+ *               builder.
+ * @param capacity number of bytes in buffer.
+ *
+ * @example
+ *   char buffer[STRING_BUILDER_STACK_CAPACITY];
+ *   string_builder sb;
+ *
+ *   string_builder_init(&sb, buffer, sizeof(buffer));
+ *   string_builder_append(&sb, "text", 4);
+ *   ...
+ *   string_builder_release(&sb);
+ */
+void string_builder_init(string_builder *sb, char *buffer, size_t capacity);
+
+/**
+ * Make room for at least 'additional' more characters.
+ *
+ * Capacity at least doubles so appending is amortized constant time.
+ *
+ * @param sb string_builder to modify.
+ * @param additional number of characters about to be added.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_grow(string_builder *sb, size_t additional);
+
+/**
+ * Make sure the string builder can hold 'capacity' characters without
+ * growing.
+ *
+ * @param sb string_builder to modify.
+ * @param capacity number of characters to hold.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_reserve(string_builder *sb, size_t capacity);
+
+/**
+ * Remove every character, keeping the memory for reuse.
+ *
+ * @param sb string_builder to modify.
+ */
+void string_builder_clear(string_builder *sb);
+
+/**
+ * Remove the characters after the first 'length' ones.
+ *
+ * @param sb string_builder to modify.
+ * @param length number of characters to keep.
+ *
+ * @return 0 on success, 4 indicates length is past the end of the string.
+ */
+int string_builder_truncate(string_builder *sb, size_t length);
+
 /**
  * Add a string to the string builder.
  *
@@ -27,10 +104,20 @@ int string_builder_create(string_builder **sb);
  * @param str string to add.
  * @param length Number of characters in the str.
  *
- * @return 0 on success, 5 otherwise.
+ * @return 0 on success, 2 indicates memory allocation failure.
  */
-int string_builder_append(string_builder *sb, const char *str,
-                          unsigned int legnth);
+static inline int string_builder_append(string_builder *sb, const char *str,
+                                        unsigned int length) {
+  if (length > sb->capacity - sb->length &&
+      string_builder_grow(sb, length) != 0) {
+    return STATUS_MEMORY_FAILURE;
+  }
+
+  memcpy(sb->data + sb->length, str, length);
+  sb->length += length;
+
+  return STATUS_SUCCESS;
+}
 
 /**
  * Add a character to the string builder.
@@ -38,9 +125,18 @@ int string_builder_append(string_builder *sb, const char *str,
  * @param sb string_builder to modify.
  * @param ch character to add.
  *
- * @return 0 on success, 5 otherwise.
+ * @return 0 on success, 2 indicates memory allocation failure.
  */
-int string_builder_append_char(string_builder *sb, const char ch);
+static inline int string_builder_append_char(string_builder *sb,
+                                             const char ch) {
+  if (sb->length == sb->capacity && string_builder_grow(sb, 1) != 0) {
+    return STATUS_MEMORY_FAILURE;
+  }
+
+  sb->data[sb->length++] = ch;
+
+  return STATUS_SUCCESS;
+}
 
 /**
  * Add a formatted string to the string builder.
@@ -55,6 +151,44 @@ int string_builder_append_char(string_builder *sb, const char ch);
  */
 int string_builder_append_fmtstr(string_builder *sb, const char *format, ...);
 
+/**
+ * Add the decimal representation of a signed integer.
+ *
+ * Digits are produced two at a time from a lookup table, no locale is
+ * consulted.
+ *
+ * @param sb string_builder to modify.
+ * @param value number to add.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_append_long(string_builder *sb, long value);
+
+/**
+ * Add the decimal representation of an unsigned integer.
+ *
+ * @param sb string_builder to modify.
+ * @param value number to add.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_append_ulong(string_builder *sb, unsigned long value);
+
+/**
+ * Add the shortest decimal representation of a double that reads back as
+ * the same value, the closest one to it when several are that short.
+ *
+ * Integral values keep a trailing ".0"(1.0), very large or small values
+ * use an exponent(1e+300 is written as 1e300). nan and inf are written as
+ * "nan", "inf" and "-inf".
+ *
+ * @param sb string_builder to modify.
+ * @param value number to add.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_append_double(string_builder *sb, double value);
+
 /**
  * Build string.
  *
@@ -67,15 +201,48 @@ int string_builder_append_fmtstr(string_builder *sb, const char *format, ...);
  */
 int string_builder_build(string_builder *sb, char **buffer);
 
+/**
+ * Build string by handing over the internal buffer.
+ *
+ * No copy is made. The builder is left empty and can be reused.
+ *
+ * @param sb string_builder to modify.
+ * @param buffer where to store the null terminated string. The caller is
+ *               responsible for deallocating it.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+int string_builder_steal(string_builder *sb, char **buffer);
+
+/**
+ * View the string being built.
+ *
+ * No copy is made. The string is only valid until the builder is modified
+ * or destroyed.
+ *
+ * @param sb string_builder to access.
+ *
+ * @return null terminated string, NULL indicates memory allocation failure.
+ */
+const char *string_builder_view(string_builder *sb);
+
 /**
  * Check if string_builder is empty.
  *
  * @param sb string_builder to check.
  *
- * @return 0 on success, 1 otherwise.
+ * @return 1 if empty, 0 otherwise.
  */
 int string_builder_is_empty(string_builder *sb);
 
+/**
+ * Deallocate the memory owned by a string_builder setup with
+ * string_builder_init, leaving it empty.
+ *
+ * @param sb string_builder to release.
+ */
+void string_builder_release(string_builder *sb);
+
 /**
  * Deallocate and set to NULL.
  *
@@ -1,30 +1,170 @@
 #ifndef STRING_SLICE_H
 #define STRING_SLICE_H
 
-typedef struct string_slice string_slice;
+/*
+ * View into a string that is owned somewhere else.
+ *
+ * A string_slice is two words passed and returned by value. Creating,
+ * splitting and trimming slices never allocates, only
+ * string_slice_to_string makes a copy.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+typedef struct string_slice {
+  const char *ptr;  // First character, not null terminated.
+  size_t len;       // Number of characters.
+} string_slice;
+
+/*
+ * Classes a character can belong to, a character may be in several.
+ */
+typedef enum string_slice_class {
+  STRING_SLICE_WHITESPACE = 1 << 0,  // ' ', '\t', '\n', '\v', '\f', '\r'
+  STRING_SLICE_DELIMITER = 1 << 1,   // ',', '='
+  STRING_SLICE_QUOTE = 1 << 2,       // '"', '\''
+  STRING_SLICE_PREFIX = 1 << 3,      // '-', '+'
+} string_slice_class;
+
+// Classes of every character, indexed by unsigned char.
+extern const unsigned char string_slice_classes[256];
+
+/**
+ * Check if a character belongs to any of the given classes.
+ *
+ * @param ch character to check.
+ * @param classes string_slice_class values or'ed together.
+ *
+ * @return 1 if it does, 0 otherwise.
+ */
+static inline int string_slice_char_is(char ch, unsigned int classes) {
+  return (string_slice_classes[(unsigned char)ch] & classes) != 0;
+}
 
 /**
- * Allocate necessary resources and setup.
+ * Make a slice of the first 'len' characters of a string.
+ *
+ * @param ptr string to slice.
+ * @param len number of characters in the slice.
+ *
+ * @return the slice.
+ */
+static inline string_slice string_slice_make(const char *ptr, size_t len) {
+  string_slice ss = {ptr, len};
+
+  return ss;
+}
+
+/**
+ * Make a slice of a null terminated string.
  *
- * @param ss string_slice to create.
  * @param str string to slice.
- * @param length number of characters in str.
  *
- * @return 0 on success, 2 indicates memory allocation failed.
+ * @return the slice.
  */
-int string_slice_create(string_slice **ss, char *str, unsigned int length);
+static inline string_slice string_slice_from_cstr(const char *str) {
+  return string_slice_make(str, str != NULL ? strlen(str) : 0);
+}
 
 /**
- * Increment the length of the string slice. 
+ * Check if the slice holds no characters.
  *
- * @param ss string_slice to create.
+ * @param ss string_slice to check.
  *
- * @return 0 on success, 5 ss is NULL. 
+ * @return 1 if empty, 0 otherwise.
  */
-int string_slice_advance(string_slice **ss);
+static inline int string_slice_is_empty(string_slice ss) {
+  return ss.len == 0;
+}
+
+// Slice of a string literal, its length is known at compile time.
+#define STRING_SLICE_LITERAL(str) string_slice_make((str), sizeof(str) - 1)
 
 /**
- * Seperate string into different regions determined by a delimioter.
+ * Check if two slices hold the same characters.
+ *
+ * Lengths are compared first, characters only when they match.
+ *
+ * @param a string_slice to compare.
+ * @param b string_slice to compare.
+ *
+ * @return 1 if equal, 0 otherwise.
+ */
+static inline int string_slice_eq(string_slice a, string_slice b) {
+  return a.len == b.len && (a.len == 0 || memcmp(a.ptr, b.ptr, a.len) == 0);
+}
+
+/**
+ * Check if a slice begins with the characters of another.
+ *
+ * @param ss string_slice to check.
+ * @param prefix characters expected at the start.
+ *
+ * @return 1 if it does, 0 otherwise.
+ */
+static inline int string_slice_starts_with(string_slice ss,
+                                           string_slice prefix) {
+  return ss.len >= prefix.len &&
+         (prefix.len == 0 || memcmp(ss.ptr, prefix.ptr, prefix.len) == 0);
+}
+
+/**
+ * Check if a slice finishes with the characters of another.
+ *
+ * @param ss string_slice to check.
+ * @param suffix characters expected at the end.
+ *
+ * @return 1 if it does, 0 otherwise.
+ */
+static inline int string_slice_ends_with(string_slice ss,
+                                         string_slice suffix) {
+  return ss.len >= suffix.len &&
+         (suffix.len == 0 ||
+          memcmp(ss.ptr + ss.len - suffix.len, suffix.ptr, suffix.len) == 0);
+}
+
+/**
+ * Compare two slices character by character, like strcmp.
+ *
+ * @param a string_slice to compare.
+ * @param b string_slice to compare.
+ *
+ * @return negative if a sorts first, 0 if equal, positive otherwise.
+ */
+int string_slice_cmp(string_slice a, string_slice b);
+
+/**
+ * Compare two slices ignoring the case of ASCII letters, like strcasecmp.
+ *
+ * @param a string_slice to compare.
+ * @param b string_slice to compare.
+ *
+ * @return negative if a sorts first, 0 if equal, positive otherwise.
+ */
+int string_slice_casecmp(string_slice a, string_slice b);
+
+/**
+ * FNV-1a hash of the characters in a slice.
+ *
+ * Matches the default hashing function of hash_table.
+ *
+ * @param ss string_slice to hash.
+ *
+ * @return hash value.
+ */
+unsigned int string_slice_hash(string_slice ss);
+
+/**
+ * Seperate string into different regions determined by a delimiter.
+ *
+ * 'output' is set to the characters before the first delimiter and 'ss'
+ * moves past it. When there is no delimiter left, 'output' is the rest of
+ * the string and the next call fails.
  *
  * @param ss string_slice to modify.
  * @param output where to store different regions.
@@ -32,43 +172,369 @@ int string_slice_advance(string_slice **ss);
  *
  * @example
  *   ...
- *   while (string_slice_split(ss, output, ':') == 0) {
+ *   while (string_slice_split(&ss, &output, ':') == 0) {
  *     // Do Work
  *   }
  *
- * @return 0 on success, 2 indicates memory allocation failed.
+ * @return 0 on success,
+ *         3 indicates ss is empty,
+ *         5 indicates ss has no string left.
+ */
+static inline int string_slice_split(string_slice *ss, string_slice *output,
+                                     const char delimiter) {
+  if (ss->ptr == NULL) {
+    *output = string_slice_make(NULL, 0);
+    return STATUS_IS_NULL;
+  }
+
+  // string slice is empty.
+  if (ss->len == 0) {
+    *output = string_slice_make(NULL, 0);
+    return STATUS_IS_EMPTY;
+  }
+
+  const char *found = memchr(ss->ptr, delimiter, ss->len);
+
+  *output = *ss;
+
+  // delimiter was not found.
+  if (found == NULL) {
+    *ss = string_slice_make(NULL, 0);
+    return STATUS_SUCCESS;
+  }
+
+  output->len = found - ss->ptr;
+  ss->ptr = found + 1;
+  ss->len -= output->len + 1;
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * Find the first character that is one of a set of characters.
+ *
+ * Sixteen(thirty two with AVX2) characters are compared at a time for sets
+ * of up to 32 characters, a single character set is searched with memchr.
+ * With more than 8 characters the first sixteen are compared one at a time
+ * first, as short fields end before the vector loop pays off.
+ *
+ * @param ss string_slice to search.
+ * @param set characters to look for.
+ * @param set_length number of characters in set.
+ *
+ * @return index of the first match, ss.len if there is none.
  */
-int string_slice_split(string_slice *ss, string_slice *output,
-                       const char delimiter);
+size_t string_slice_find_any(string_slice ss, const char *set,
+                             size_t set_length);
 
 /**
- * Remove whitespace before and after the string being built.
+ * Find the first occurrence of one slice in another, like memmem.
+ *
+ * Needles of up to 64 characters are found by comparing their first and
+ * last two characters against thirty two positions at a time, only
+ * candidates that match all three are compared in full. Longer needles use
+ * the Two-Way algorithm, which runs in linear time without extra memory.
+ *
+ * @param haystack string_slice to search.
+ * @param needle characters to look for.
+ *
+ * @return index of the first occurrence, haystack.len if there is none.
+ *         An empty needle is found at 0.
+ */
+size_t string_slice_find(string_slice haystack, string_slice needle);
+
+/**
+ * Seperate string into different regions determined by a set of
+ * delimiters.
+ *
+ * Same as string_slice_split, any character in 'set' ends a region.
  *
  * @param ss string_slice to modify.
+ * @param output where to store different regions.
+ * @param set characters marking the seperation.
+ * @param set_length number of characters in set.
  *
  * @return 0 on success,
- *         3 indicates 'ss' is empty,
- *         5 indicates 'ss' is NULL,
+ *         3 indicates ss is empty,
+ *         5 indicates ss has no string left.
  */
-int string_slice_trim(string_slice *ss);
+int string_slice_split_set(string_slice *ss, string_slice *output,
+                           const char *set, size_t set_length);
 
 /**
- * Remove whitespace before and after the string being built.
+ * Seperate string into different regions determined by character classes.
+ *
+ * Same as string_slice_split, any character in 'classes' ends a region.
  *
  * @param ss string_slice to modify.
- * @param str where to store the constructed string slice.
+ * @param output where to store different regions.
+ * @param classes string_slice_class values or'ed together.
  *
  * @return 0 on success,
- *         2 indicates failure to allocation memory for 'str',
- *         5 indicates ss is NULL,
+ *         3 indicates ss is empty,
+ *         5 indicates ss has no string left.
+ */
+int string_slice_split_any(string_slice *ss, string_slice *output,
+                           unsigned int classes);
+
+/**
+ * Count the leading characters that belong to the given classes.
+ *
+ * @param ss string_slice to scan.
+ * @param classes string_slice_class values or'ed together.
+ *
+ * @return number of characters.
  */
-int string_slice_to_string(string_slice *ss, char **str);
+static inline size_t string_slice_span(string_slice ss, unsigned int classes) {
+  size_t index = 0;
+
+  while (index < ss.len && string_slice_char_is(ss.ptr[index], classes)) {
+    index++;
+  }
+
+  return index;
+}
 
 /**
- * Deallocate and set to NULL.
+ * Count the leading characters that do not belong to the given classes.
+ *
+ * @param ss string_slice to scan.
+ * @param classes string_slice_class values or'ed together.
  *
- * @param ss string_builder to deallocate.
+ * @return number of characters.
  */
-void string_slice_destroy(string_slice **ss);
+static inline size_t string_slice_cspan(string_slice ss,
+                                        unsigned int classes) {
+  size_t index = 0;
+
+  while (index < ss.len && !string_slice_char_is(ss.ptr[index], classes)) {
+    index++;
+  }
+
+  return index;
+}
+
+/*
+ * Walks the fields of a slice one after another.
+ *
+ * Every call starts where the previous field ended, so no character is
+ * looked at twice. Unlike string_slice_split, empty fields are kept:
+ * "a,,b" yields "a", "" and "b".
+ */
+typedef struct string_slice_iter {
+  string_slice rest;  // Characters not yet returned.
+  const char *set;    // Delimiters, owned by the caller.
+  size_t set_length;  // Number of delimiters.
+  char done;          // Last field was returned.
+} string_slice_iter;
+
+/**
+ * Setup an iterator over the fields of a slice.
+ *
+ * @param it string_slice_iter to setup.
+ * @param ss string_slice to walk.
+ * @param set characters marking the end of a field, must outlive it.
+ * @param set_length number of characters in set.
+ *
+ * @example
+ *   string_slice_iter it;
+ *   string_slice field;
+ *
+ *   string_slice_iter_init(&it, ss, ",;", 2);
+ *   while (string_slice_iter_next(&it, &field) == 0) {
+ *     // Do Work
+ *   }
+ */
+void string_slice_iter_init(string_slice_iter *it, string_slice ss,
+                            const char *set, size_t set_length);
+
+/**
+ * Get the next field.
+ *
+ * @param it string_slice_iter to advance.
+ * @param field where to store the field, may be empty.
+ *
+ * @return 0 on success, 3 indicates there are no fields left.
+ */
+int string_slice_iter_next(string_slice_iter *it, string_slice *field);
+
+/**
+ * Remove whitespace(spaces, tabs and line breaks) before and after the
+ * string.
+ *
+ * @param ss string_slice to trim.
+ *
+ * @return the trimmed slice.
+ */
+static inline string_slice string_slice_trim(string_slice ss) {
+  size_t left = string_slice_span(ss, STRING_SLICE_WHITESPACE);
+
+  // trim left
+  ss.ptr += left;
+  ss.len -= left;
+
+  // trim right
+  while (ss.len > 0 &&
+         string_slice_char_is(ss.ptr[ss.len - 1], STRING_SLICE_WHITESPACE)) {
+    ss.len--;
+  }
+
+  return ss;
+}
+
+/**
+ * Convert a base 10 integer, like strtol, without copying the slice.
+ *
+ * The whole slice must be the number: an optional sign followed by
+ * digits.
+ *
+ * @param ss string_slice to convert.
+ * @param value where to store the number.
+ * @param error_index where to store the position of the first character
+ *                    that was not converted(ss.len on success), may be
+ *                    NULL.
+ *
+ * @return 0 on success,
+ *         1 indicates an invalid character at error_index,
+ *         3 indicates ss is empty,
+ *         4 indicates the number does not fit in a long,
+ *         5 indicates ss has no string.
+ */
+int string_slice_to_long(string_slice ss, long *value, size_t *error_index);
+
+/**
+ * Convert a base 10 unsigned integer, like strtoul, without copying the
+ * slice.
+ *
+ * Unlike strtoul, a minus sign is an invalid character.
+ *
+ * @param ss string_slice to convert.
+ * @param value where to store the number.
+ * @param error_index where to store the position of the first character
+ *                    that was not converted(ss.len on success), may be
+ *                    NULL.
+ *
+ * @return 0 on success,
+ *         1 indicates an invalid character at error_index,
+ *         3 indicates ss is empty,
+ *         4 indicates the number does not fit in an unsigned long,
+ *         5 indicates ss has no string.
+ */
+int string_slice_to_ulong(string_slice ss, unsigned long *value,
+                          size_t *error_index);
+
+/**
+ * Convert a decimal floating point number, like strtod.
+ *
+ * Numbers with at most 19 significant digits and a small exponent are
+ * converted exactly in place, longer mantissas and large exponents are
+ * copied and handed to strtod. Like string_slice_to_long, and unlike
+ * strtod, leading whitespace, hex, inf and nan are rejected.
+ *
+ * @param ss string_slice to convert.
+ * @param value where to store the number.
+ * @param error_index where to store the position of the first character
+ *                    that was not converted(ss.len on success), may be
+ *                    NULL.
+ *
+ * @return 0 on success,
+ *         1 indicates an invalid character at error_index,
+ *         2 indicates memory allocation failed,
+ *         3 indicates ss is empty,
+ *         4 indicates the number is out of range,
+ *         5 indicates ss has no string.
+ */
+int string_slice_to_double(string_slice ss, double *value,
+                           size_t *error_index);
+
+/**
+ * Convert a boolean: true, yes, on and 1 or false, no, off and 0, in any
+ * case.
+ *
+ * @param ss string_slice to convert.
+ * @param value where to store the boolean.
+ * @param error_index where to store 0 when ss is not a boolean and ss.len
+ *                    on success, may be NULL.
+ *
+ * @return 0 on success,
+ *         1 indicates ss is not a boolean,
+ *         3 indicates ss is empty,
+ *         5 indicates ss has no string.
+ */
+int string_slice_to_bool(string_slice ss, bool *value, size_t *error_index);
+
+/**
+ * Check that a slice is well formed UTF-8.
+ *
+ * Overlong forms, surrogates and code points past U+10FFFF are rejected.
+ * On CPUs with SSSE3 sixteen bytes are checked at a time with lookup
+ * tables, otherwise ASCII is skipped sixteen bytes at a time and the rest
+ * is decoded.
+ *
+ * @param ss string_slice to check.
+ * @param error_index where to store the position of the first byte of the
+ *                    invalid sequence(ss.len when valid), may be NULL.
+ *
+ * @return 0 on success, 1 indicates an invalid sequence at error_index.
+ */
+int string_slice_validate_utf8(string_slice ss, size_t *error_index);
+
+/**
+ * Count the code points of a UTF-8 slice.
+ *
+ * Every byte that does not continue a sequence starts a code point, so an
+ * invalid byte counts as one.
+ *
+ * @param ss string_slice to count.
+ *
+ * @return number of code points.
+ */
+size_t string_slice_count_codepoints(string_slice ss);
+
+/**
+ * Number of terminal columns a UTF-8 slice takes up.
+ *
+ * Combining marks take none, East Asian wide characters and emoji take
+ * two, everything else(including invalid bytes) takes one.
+ *
+ * @param ss string_slice to measure.
+ *
+ * @return number of columns.
+ */
+size_t string_slice_display_width(string_slice ss);
+
+/**
+ * Copy the slice into a new null terminated string.
+ *
+ * @param ss string_slice to copy.
+ * @param str where to store the string, NULL if ss is empty. The caller is
+ *            responsible for deallocating it.
+ *
+ * @return 0 on success,
+ *         2 indicates failure to allocation memory for 'str',
+ *         3 indicates ss is empty,
+ *         5 indicates ss has no string.
+ */
+static inline int string_slice_to_string(string_slice ss, char **str) {
+  *str = NULL;
+
+  if (ss.ptr == NULL) {
+    return STATUS_IS_NULL;
+  }
+
+  // string slice is empty.
+  if (ss.len == 0) {
+    return STATUS_IS_EMPTY;
+  }
+
+  if ((*str = malloc(ss.len + 1)) == NULL) {
+    return STATUS_MEMORY_FAILURE;
+  }
+
+  memcpy(*str, ss.ptr, ss.len);
+  (*str)[ss.len] = '\0';
+
+  return STATUS_SUCCESS;
+}
 
 #endif  // STRING_SLICE_H
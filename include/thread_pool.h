@@ -0,0 +1,80 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * Fixed size pool of worker threads.
+ *
+ * Every worker owns a queue of tasks. Workers take tasks from the back of
+ * their own queue and steal from the front of other queues when theirs is
+ * empty. The thread waiting for the work helps run the tasks.
+ */
+
+typedef struct thread_pool thread_pool;
+
+/**
+ * Allocate necessary resources and start the worker threads.
+ *
+ * @param pool thread_pool to create.
+ * @param num_threads number of worker threads. If 0, one per online CPU.
+ *
+ * @return 0 on success,
+ *         1 indicates failure to start a worker thread,
+ *         2 indicates memory allocation failed.
+ */
+int thread_pool_create(thread_pool **pool, unsigned int num_threads);
+
+/**
+ * Retrieve the pool shared by the library.
+ *
+ * Created with one worker per online CPU on first use and destroyed at exit.
+ *
+ * @param pool where to store the shared pool.
+ *
+ * @return 0 on success,
+ *         1 indicates failure to start a worker thread,
+ *         2 indicates memory allocation failed.
+ */
+int thread_pool_get_default(thread_pool **pool);
+
+/**
+ * Retrieve the number of worker threads in the pool.
+ *
+ * @param pool the pool to access.
+ *
+ * @return -1 indicates pool is NULL, positive number otherwise.
+ */
+int thread_pool_get_size(thread_pool *pool);
+
+/**
+ * Split the range [0, length) into chunks and process them in parallel.
+ *
+ * Returns once every chunk has been processed. Safe to call from inside a
+ * task running on the same pool.
+ *
+ * @param pool thread_pool to run the chunks on.
+ * @param length number of indices to process.
+ * @param grain number of indices per chunk. If 0, one is picked so every
+ *              worker gets several chunks.
+ * @param fn Function that processes the indices [begin, end). A non 0 return
+ *           value marks the whole range as failed.
+ * @param ctx user data passed to fn.
+ *
+ * @return 0 on success,
+ *         1 indicates fn failed for at least one chunk,
+ *         2 indicates memory allocation failed,
+ *         5 indicates pool or fn is NULL.
+ */
+int thread_pool_parallel_for(thread_pool *pool, unsigned int length,
+                             unsigned int grain,
+                             int (*fn)(unsigned int begin, unsigned int end,
+                                       void *ctx),
+                             void *ctx);
+
+/**
+ * Stop the worker threads, deallocate and set to NULL.
+ *
+ * @param pool thread_pool to deallocate.
+ */
+void thread_pool_destroy(thread_pool **pool);
+
+#endif  // THREAD_POOL_H
@@ -5,13 +5,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "dynamic_array.h"
 #include "hash_table.h"
+#include "json_writer.h"
 #include "logger.h"
+#include "output_sink.h"
+#include "string_array.h"
 #include "string_builder.h"
 #include "string_slice.h"
 
+// Width of the help message when the terminal width is unknown.
+#define HELP_DEFAULT_WIDTH 80
+// Help text never starts past this column.
+#define HELP_MAX_POSITION 24
+// Help text never wraps narrower than this many columns.
+#define HELP_MIN_WIDTH 11
+// Indentation of every argument in the help message.
+#define HELP_INDENT 2
+#define HELP_SHORT_NAME "-h"
+#define HELP_LONG_NAME "--help"
+#define HELP_AUTO_INVOCATION HELP_SHORT_NAME ", " HELP_LONG_NAME
+#define HELP_AUTO_TEXT "show this help message and exit"
+
 /**
  * Add property to argparser.
  * If prop is not empty, then allocate memory.
@@ -25,6 +44,7 @@
     }                                    \
     /*  TODO: malloc here */             \
     (*(parser))->prop = prop;            \
+    invalidate_help(*(parser));          \
   } while (0)
 
 /**
@@ -54,6 +74,25 @@ typedef enum arg_kind {
   ARG_KIND_OPT_NAME,
 } arg_kind;
 
+// Kind of error found while parsing, written as "code" in JSON diagnostics.
+typedef enum error_code {
+  ERROR_EXPECTED_ARGUMENT,
+  ERROR_INVALID_VALUE,
+  ERROR_OUT_OF_RANGE,
+  ERROR_INVALID_UTF8,
+  ERROR_UNRECOGNIZED_ARGUMENT,
+  ERROR_MISSING_REQUIRED,
+} error_code;
+
+static const char *const error_code_names[] = {
+    [ERROR_EXPECTED_ARGUMENT] = "expected_argument",
+    [ERROR_INVALID_VALUE] = "invalid_value",
+    [ERROR_OUT_OF_RANGE] = "out_of_range",
+    [ERROR_INVALID_UTF8] = "invalid_utf8",
+    [ERROR_UNRECOGNIZED_ARGUMENT] = "unrecognized_argument",
+    [ERROR_MISSING_REQUIRED] = "missing_required",
+};
+
 typedef struct argparser_argument {
   argparser_arg_action action;  // how command line args should be handled.
   char *choices;        // Comma seperated string of acceptable arg values.
@@ -92,18 +131,43 @@ struct argparser {
                                       // be passed in.
   string_builder *unrecognized_args;  // Arguments that don't match the
                                       // parser arguments.
-  dynamic_array *errors;              // Argument errors. Array of char*.
+  string_builder *scratch;            // Reused to build messages.
+  dynamic_array *arg_order;           // Arguments in the order they were
+                                      // added. Array of argparser_argument*.
+  string_builder diagnostics;         // Errors rendered during a parse,
+                                      // written to sink in one go.
+  json_writer json;                   // Writes diagnostics in JSON format.
+  output_sink *sink;                  // Where errors are rendered.
   char *name;                         // Program name(default is argv[0])
   char *usage;                        // Describing program usage.
   char *description;           // Text to display before argument help message.
   char *epilogue;              // text to display after argument help message
   char *prefix_chars;          // Chars that prefix optional arguments('-')
+  const char *static_help;     // Help message embedded at build time.
+  char *help_cache;            // Help message rendered for help_cache_width,
+                               // NULL until needed or after a change.
+  size_t help_cache_length;    // Number of characters in help_cache.
+  unsigned int help_cache_width;  // Width help_cache was wrapped to.
   char add_help;               // Add -h/--help option to the parser.
   char allow_abbrev;           // Allow abbreviations of long args name.
+  char strict_utf8;            // Reject arguments that are not UTF-8.
+  char owns_sink;              // sink is the default one(stderr).
+  char help_requested;         // -h/--help was passed to the last parse.
+  long options_end;            // argv index of the first "--" being parsed.
+  argparser_diagnostics_format diagnostics_format;  // Text or JSON errors.
   unsigned int pos_args_size;  // Number of positional arguments.
   unsigned int req_opt_args_size;  // Number of required optional arguments.
 };
 
+/**
+ * Drop the cached help message, called whenever something it shows
+ * changes.
+ */
+static void invalidate_help(argparser *parser) {
+  free(parser->help_cache);
+  parser->help_cache = NULL;
+}
+
 /**
  * Allocate necessary resources and setup.
  *
@@ -203,6 +267,7 @@ static int determine_argument(char short_name[2], char *long_name) {
 /**
  * Concatinate command line arguments into a string.
  *
+ * @param parser argparser
  * @param argc argument count.
  * @param argv all command line arguments passed in.
  * @param str buffer used to store the final string.
@@ -211,18 +276,17 @@ static int determine_argument(char short_name[2], char *long_name) {
  *         1 indicates failure to build.
  *         2 indicates memory allocation failed, str set to NULL.
  */
-static int concat_argv(int argc, char *argv[], char **str) {
+static int concat_argv(argparser *parser, int argc, char *argv[],
+                       char **str) {
   int result = STATUS_SUCCESS;
-  string_builder *sb;
+  string_builder *sb = parser->scratch;
 
-  if ((string_builder_create(&sb)) != 0) {
-    *str = NULL;
-    RETURN_DEFER(STATUS_MEMORY_FAILURE);
-  }
+  string_builder_clear(sb);
 
   for (int i = 1; i < argc; i++) {
     if ((string_builder_append(sb, argv[i], strlen(argv[i]))) != 0) {
-      RETURN_DEFER(STATUS_FAILURE);
+      *str = NULL;
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
     }
     if (i != argc - 1) {
       // Add space after each arg except the last one.
@@ -233,15 +297,43 @@ static int concat_argv(int argc, char *argv[], char **str) {
   result = string_builder_build(sb, str);
 
 defer:
-  if (sb != NULL) {
-    string_builder_destroy(&sb);
-  }
   return result;
 }
 
+/**
+ * Find the argument an entry of the optional arguments string refers to.
+ *
+ * Entries look like "-f,--foo", "-0" and "--0" mark a missing flag or
+ * name. The argument is stored under its name when it has one.
+ *
+ * @param parser argparser
+ * @param flag_slice flag part of the entry.
+ * @param name_slice name part of the entry.
+ *
+ * @return the argument, NULL if it is not defined.
+ */
+static argparser_argument *find_opt_arg(argparser *parser,
+                                        string_slice flag_slice,
+                                        string_slice name_slice) {
+  argparser_argument *arg = NULL;
+  string_slice key = name_slice;
+
+  if (string_slice_eq(name_slice, STRING_SLICE_LITERAL("--0")) &&
+      !string_slice_eq(flag_slice, STRING_SLICE_LITERAL("-0"))) {
+    // flag found.
+    key = flag_slice;
+  }
+
+  hash_table_search_n(parser->arguments, key.ptr, key.len, (void **)&arg);
+
+  return arg;
+}
+
 /**
  * Add argument flags to hash table.
  *
+ * Every flag maps to its argument, so parsing a flag takes one lookup.
+ *
  * @param parser argparser
  * @param flags hash table to modify.
  *
@@ -250,144 +342,242 @@ defer:
 static int separate_opt_args(argparser *parser, hash_table **flags) {
   int result = STATUS_SUCCESS;
 
-  if (((result = hash_table_create(flags, sizeof(char *), NULL, NULL)) != 0)) {
+  if (((result = hash_table_create(flags, sizeof(argparser_argument *), NULL,
+                                   NULL)) != 0)) {
     RETURN_DEFER(result);
   }
 
-  string_slice *ss = NULL;
-  string_slice *output = NULL;
-  char *opt_args = NULL;
+  string_slice ss;
+  string_slice output;
+  string_slice flag_slice;
+  string_slice name_slice;
+  const char *opt_args = NULL;
 
-  string_builder_build(parser->optional_args, &opt_args);
-
-  if (((result = string_slice_create(&ss, opt_args, strlen(opt_args))) != 0) ||
-      (result = string_slice_create(&output, NULL, 0)) != 0) {
-    RETURN_DEFER(result);
+  if ((opt_args = string_builder_view(parser->optional_args)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
   }
 
-  string_slice *flag_slice = NULL;
-  string_slice *name_slice = NULL;
-  char *flag = NULL;
-  char *name = NULL;
-  char *opt_str = NULL;
+  ss = string_slice_trim(string_slice_from_cstr(opt_args));
 
-  string_slice_trim(ss);
+  while (string_slice_split(&ss, &output, ' ') == 0) {
+    name_slice = output;
+    string_slice_split(&name_slice, &flag_slice, ',');
 
-  while (string_slice_split(ss, output, ' ') == 0) {
-    string_slice_to_string(output, &opt_str);
-    string_slice_create(&name_slice, opt_str, strlen(opt_str));
-    string_slice_create(&flag_slice, NULL, 0);
-    string_slice_split(name_slice, flag_slice, ',');
-    string_slice_to_string(flag_slice, &flag);
-    string_slice_to_string(name_slice, &name);
+    // name found, it has no flag.
+    if (string_slice_eq(flag_slice, STRING_SLICE_LITERAL("-0"))) {
+      continue;
+    }
 
-    if (strncmp(flag, "-0", 2) != 0 && strncmp(name, "--0", 3) == 0) {
-      // flag found.
-      hash_table_insert(*flags, flag, "--0");
-    } else if (strncmp(name, "--0", 3) != 0 && strncmp(flag, "-0", 2) == 0) {
-      // name found.
-    } else {
-      // flag and name are defined.
-      hash_table_insert(*flags, flag, name);
+    argparser_argument *arg = find_opt_arg(parser, flag_slice, name_slice);
+
+    if (arg != NULL) {
+      hash_table_insert_n(*flags, flag_slice.ptr, flag_slice.len, &arg);
     }
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Add positional arguments to string array.
+ *
+ * @param parser argparser
+ * @param pos_args string array to create.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int separate_pos_args(argparser *parser, string_array **pos_args) {
+  int result = STATUS_SUCCESS;
+  char *pos_args_str = NULL;
+
+  if ((result = string_array_create(pos_args)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = string_builder_build(parser->positional_args,
+                                     &pos_args_str)) != 0) {
+    RETURN_DEFER(result);
+  }
 
-    string_slice_destroy(&flag_slice);
-    string_slice_destroy(&name_slice);
-    free(flag);
-    flag = NULL;
-    free(name);
-    name = NULL;
-    free(opt_str);
-    opt_str = NULL;
+  // Names are separated by spaces.
+  char *start = pos_args_str;
+  char *end = NULL;
+
+  while ((end = strchr(start, ' ')) != NULL) {
+    if (end != start &&
+        (result = string_array_append(*pos_args, start, end - start)) != 0) {
+      RETURN_DEFER(result);
+    }
+    start = end + 1;
   }
 
-  string_slice_destroy(&ss);
-  string_slice_destroy(&output);
-  free(opt_args);
+  if (*start != '\0' &&
+      (result = string_array_append(*pos_args, start, strlen(start))) != 0) {
+    RETURN_DEFER(result);
+  }
 
 defer:
+  if (pos_args_str != NULL) {
+    free(pos_args_str);
+  }
   return result;
 }
 
 /**
- * Deallocate memory for string.
+ * Start an error message in the parser diagnostics, formatted like
+ * LOG_ERROR. The message is finished by end_error.
+ *
+ * @param parser argparser
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
  */
-static void destroy_str(void **str) {
-  free(str);
-  str = NULL;
+static int begin_error(argparser *parser) {
+  static const char prefix[] = TERMINAL_RED "error" TERMINAL_RESET ": ";
+
+  // Like the logger, only stderr gets colors and only when it is a
+  // terminal. Caller supplied sinks always get plain text.
+  if (parser->owns_sink && logger_use_colors()) {
+    return string_builder_append(&parser->diagnostics, prefix,
+                                 sizeof(prefix) - 1);
+  }
+
+  return string_builder_append(&parser->diagnostics, "error: ", 7);
 }
 
 /**
- * Add positional arguments to dynamic array.
+ * Finish the error message started by begin_error.
  *
  * @param parser argparser
- * @param pos_args dynamic array to modify.
  *
  * @return 0 on success, 2 indicates memory allocation failed.
  */
-static int separate_pos_args(argparser *parser, dynamic_array **pos_args) {
-  int result = STATUS_SUCCESS;
+static int end_error(argparser *parser) {
+  return string_builder_append_char(&parser->diagnostics, '\n');
+}
 
-  if ((result =
-           dynamic_array_create(pos_args, sizeof(char *), destroy_str, NULL))) {
-    RETURN_DEFER(result);
+/**
+ * Find which command line argument a position of the concatenated
+ * arguments belongs to, arguments are separated by a single space.
+ *
+ * @param args_str concatenated arguments.
+ * @param offset position in args_str.
+ *
+ * @return index of the argument in argv.
+ */
+static long token_at(const char *args_str, size_t offset) {
+  long token = 1;
+
+  for (size_t i = 0; i < offset; i++) {
+    token += args_str[i] == ' ';
   }
 
-  char *pos_args_str = NULL;
-  string_slice *ss = NULL;
-  string_slice *output = NULL;
-  char *name = NULL;
+  return token;
+}
 
-  string_builder_build(parser->positional_args, &pos_args_str);
+/**
+ * Write an error record into the parser diagnostics, the JSON array is
+ * opened by the first record and closed by print_errors.
+ *
+ * @param parser argparser
+ * @param code kind of error.
+ * @param token index of the argument in argv, -1 if unknown.
+ * @param short_name argument short name, ptr is NULL if missing.
+ * @param long_name argument long name, ptr is NULL if missing.
+ * @param message description of the error.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates the records are nested too deep.
+ */
+static int write_error_record(argparser *parser, error_code code, long token,
+                              string_slice short_name, string_slice long_name,
+                              const char *message) {
+  int result = STATUS_SUCCESS;
+  json_writer *jw = &parser->json;
+
+  if (jw->depth == 0 && (result = json_writer_begin_array(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
 
-  if (((result = string_slice_create(&ss, pos_args_str,
-                                     strlen(pos_args_str))) != 0) ||
-      (result = string_slice_create(&output, NULL, 0)) != 0) {
+  if ((result = json_writer_begin_object(jw)) != 0) {
     RETURN_DEFER(result);
   }
 
-  string_slice_trim(ss);
-  while (string_slice_split(ss, output, ' ') == 0) {
-    string_slice_to_string(output, &name);
+  json_writer_key(jw, "code", 4);
+  json_writer_string(jw, error_code_names[code],
+                     strlen(error_code_names[code]));
+
+  json_writer_key(jw, "argument", 8);
+  if (short_name.ptr == NULL && long_name.ptr == NULL) {
+    json_writer_null(jw);
+  } else {
+    json_writer_begin_string(jw);
+
+    if (short_name.ptr != NULL) {
+      json_writer_append_string(jw, short_name.ptr, short_name.len);
+    }
+
+    if (short_name.ptr != NULL && long_name.ptr != NULL) {
+      json_writer_append_string(jw, "/", 1);
+    }
+
+    if (long_name.ptr != NULL) {
+      json_writer_append_string(jw, long_name.ptr, long_name.len);
+    }
 
-    dynamic_array_add_str(*pos_args, name);
-    // FREE(name);
-    // name = NULL;
+    json_writer_end_string(jw);
   }
 
-  string_slice_destroy(&ss);
-  string_slice_destroy(&output);
-  free(pos_args_str);
+  json_writer_key(jw, "token", 5);
+  if (token < 0) {
+    json_writer_null(jw);
+  } else {
+    json_writer_long(jw, token);
+  }
+
+  json_writer_key(jw, "message", 7);
+  json_writer_string(jw, message, strlen(message));
+
+  result = json_writer_end_object(jw);
 
 defer:
   return result;
 }
 
 /**
- * Append error message to parser errors array.
+ * Render an argument error into the parser diagnostics.
  *
  * @param parser argparser
+ * @param code kind of error.
+ * @param token index of the argument in argv, -1 if unknown.
  * @param short_name argument short name.
  * @param long_name argument long name.
  * @param error_message message to append at the end of the constructed message.
 
  * @return 0 on success, 2 indicates memory allocation failed.
  */
-static int add_error_to_parser(argparser *parser, const char *short_name,
-                               const char *long_name,
+static int add_error_to_parser(argparser *parser, error_code code, long token,
+                               const char *short_name, const char *long_name,
                                const char *error_message) {
   int result = STATUS_SUCCESS;
-  string_builder *sb = NULL;
-  char *message = NULL;
+  string_builder *sb = &parser->diagnostics;
 
-  if ((result = string_builder_create(&sb)) != 0) {
+  if (parser->diagnostics_format == AP_DIAGNOSTICS_JSON) {
+    RETURN_DEFER(write_error_record(parser, code, token,
+                                    string_slice_from_cstr(short_name),
+                                    string_slice_from_cstr(long_name),
+                                    error_message));
+  }
+
+  if ((result = begin_error(parser)) != 0) {
     RETURN_DEFER(result);
   }
 
   string_builder_append(sb, "argument ", 9);
 
   if (short_name != NULL) {
-    string_builder_append_fmtstr(sb, "%s", short_name);
+    string_builder_append(sb, short_name, strlen(short_name));
   }
 
   if (short_name != NULL && long_name != NULL) {
@@ -401,32 +591,89 @@ static int add_error_to_parser(argparser *parser, const char *short_name,
   string_builder_append(sb, ": ", 2);
   string_builder_append(sb, error_message, strlen(error_message));
 
-  string_builder_build(sb, &message);
+  result = end_error(parser);
 
-  if (parser->errors == NULL) {
-    if (dynamic_array_create(&parser->errors, sizeof(char *), destroy_str,
-                             NULL) != 0) {
-      RETURN_DEFER(result);
+defer:
+  return result;
+}
+
+/**
+ * Record an argument that does not match any of the parser arguments.
+ *
+ * In text format they are collected and reported together by
+ * print_errors.
+ *
+ * @param parser argparser
+ * @param token index of the argument in argv.
+ * @param name the argument as passed.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int add_unrecognized_to_parser(argparser *parser, long token,
+                                      string_slice name) {
+  int result = STATUS_SUCCESS;
+
+  if (parser->diagnostics_format == AP_DIAGNOSTICS_JSON) {
+    if (name.len > 0) {
+      result = write_error_record(parser, ERROR_UNRECOGNIZED_ARGUMENT, token,
+                                  name, string_slice_make(NULL, 0),
+                                  "unrecognized argument");
     }
+    RETURN_DEFER(result);
   }
 
-  if (dynamic_array_add_str(parser->errors, message) != 0) {
+  // Only allocate memory if unrecognized argument has been detected.
+  if (parser->unrecognized_args == NULL &&
+      (result = string_builder_create(&parser->unrecognized_args)) != 0) {
     RETURN_DEFER(result);
   }
 
-defer:
-  if (sb != NULL) {
-    string_builder_destroy(&sb);
+  if (name.len > 0) {
+    string_builder_append(parser->unrecognized_args, name.ptr, name.len);
+    result = string_builder_append_char(parser->unrecognized_args, ' ');
   }
 
+defer:
   return result;
 }
 
+/**
+ * Report every command line argument that is not valid UTF-8.
+ *
+ * @param parser argparser
+ * @param argc number of arguments.
+ * @param argv arguments, the first one is the program name.
+ */
+static void validate_utf8_args(argparser *parser, int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    size_t error_index = 0;
+
+    if (string_slice_validate_utf8(string_slice_from_cstr(argv[i]),
+                                   &error_index) != 0) {
+      char position[16];
+      char message[64];
+
+      snprintf(position, sizeof(position), "%d", i);
+      snprintf(message, sizeof(message), "invalid UTF-8 at byte %zu",
+               error_index);
+      // In JSON the token already tells which argument it is.
+      add_error_to_parser(
+          parser, ERROR_INVALID_UTF8, i, NULL,
+          parser->diagnostics_format == AP_DIAGNOSTICS_JSON ? NULL : position,
+          message);
+    }
+  }
+}
+
 /**
  * Validate the argument type based on it's 'type' property.
  *
+ * Numbers are converted straight from the argument string, only string
+ * values are copied.
+ *
  * @param parser argparser
  * @param arg The argument to check.
+ * @param args_str concatenated arguments value points into.
  * @param value The value to validate.
  *
  * @return 0 on success,
@@ -434,79 +681,69 @@ defer:
  *         2 indicates arg value is invalid.
  */
 static int validate_argument_type(argparser *parser, argparser_argument *arg,
-                                  char *arg_value) {
+                                  const char *args_str, string_slice value) {
   int result = STATUS_SUCCESS;
+  int status = STATUS_SUCCESS;
+  const char *type_name = NULL;
 
   if (arg->value != NULL) {
     // Deallocate previous value
     free(arg->value);
+    arg->value = NULL;
   }
 
   switch (arg->type) {
     case AP_ARG_FLOAT: {
-      char *endptr = NULL;
-      char *str = arg_value;
-      errno = 0;
-      double val = strtod(str, &endptr);
-
-      if (errno == ERANGE) {
-        add_error_to_parser(parser, arg->short_name, arg->long_name,
-                            "numerical result is out of range");
-        RETURN_DEFER(1);
-      }
-
-      if (endptr == str || strlen(endptr) > 0) {
-        char message[50];
-        snprintf(message, 50, "invalid float value: '%s'", arg_value);
-        add_error_to_parser(parser, arg->short_name, arg->long_name, message);
-        RETURN_DEFER(2);
-      }
-
-      free(arg_value);
-      arg_value = NULL;
+      double val = 0;
 
-      arg->value = (double *)malloc(sizeof(double));
-      *(double *)arg->value = val;
+      type_name = "float";
 
+      if ((status = string_slice_to_double(value, &val, NULL)) == 0) {
+        arg->value = (double *)malloc(sizeof(double));
+        *(double *)arg->value = val;
+      }
       break;
     }
     case AP_ARG_INT: {
-      char *endptr = NULL;
-      char *str = arg_value;
-      errno = 0;
-      long val = strtol(str, &endptr, 10);
-
-      if (errno == ERANGE) {
-        add_error_to_parser(parser, arg->short_name, arg->long_name,
-                            "numerical result is out of range");
-        RETURN_DEFER(1);
-      }
-
-      if (endptr == str || strlen(endptr) > 0) {
-        char message[50];
-        snprintf(message, 50, "invalid int value: '%s'", arg_value);
-        add_error_to_parser(parser, arg->short_name, arg->long_name, message);
-        RETURN_DEFER(2);
-      }
+      long val = 0;
 
-      free(arg_value);
-      arg_value = NULL;
-
-      arg->value = (long *)malloc(sizeof(long));
-      *(long *)arg->value = val;
+      type_name = "int";
 
+      if ((status = string_slice_to_long(value, &val, NULL)) == 0) {
+        arg->value = (long *)malloc(sizeof(long));
+        *(long *)arg->value = val;
+      }
       break;
     }
     case AP_ARG_STRING:
-      arg->value = arg_value;
+      string_slice_to_string(value, (char **)&arg->value);
       break;
   }
 
-defer:
-  if (arg_value != NULL && arg->type != AP_ARG_STRING) {
-    free(arg_value);
+  if (status == STATUS_OUT_OF_BOUNDS) {
+    add_error_to_parser(parser, ERROR_OUT_OF_RANGE,
+                        token_at(args_str, value.ptr - args_str),
+                        arg->short_name, arg->long_name,
+                        "numerical result is out of range");
+    RETURN_DEFER(1);
   }
 
+  // A missing value has already been reported.
+  if (status == STATUS_IS_EMPTY || status == STATUS_IS_NULL) {
+    RETURN_DEFER(2);
+  }
+
+  if (status != STATUS_SUCCESS) {
+    char message[50];
+    snprintf(message, 50, "invalid %s value: '%.*s'", type_name,
+             (int)value.len, value.ptr);
+    add_error_to_parser(parser, ERROR_INVALID_VALUE,
+                        token_at(args_str, value.ptr - args_str),
+                        arg->short_name, arg->long_name, message);
+    RETURN_DEFER(2);
+  }
+
+defer:
   return result;
 }
 
@@ -521,12 +758,14 @@ defer:
  */
 static int validate_argument(argparser *parser, argparser_argument *arg,
                              char *args_str, unsigned short index) {
+  // Errors about the argument itself point at the flag or name.
+  unsigned short arg_index = index;
+
   switch (arg->action) {
     case AP_ARG_STORE_APPEND:
       break;
     case AP_ARG_STORE: {
-      string_slice *value_slice = NULL;
-      char *arg_value = NULL;
+      string_slice value_slice;
       int ss_length = 0;
 
       if (args_str[index] == ' ') {
@@ -534,12 +773,13 @@ static int validate_argument(argparser *parser, argparser_argument *arg,
         index++;
       }
 
-      string_slice_create(&value_slice, args_str + index, 0);
+      value_slice = string_slice_make(args_str + index, 0);
 
       while (args_str[index] != ' ') {
         if (*(args_str + index) == '\0' && ss_length == 0) {
-          add_error_to_parser(parser, arg->short_name, arg->long_name,
-                              "expected one argument");
+          add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                              token_at(args_str, arg_index), arg->short_name,
+                              arg->long_name, "expected one argument");
           break;
         }
 
@@ -548,19 +788,16 @@ static int validate_argument(argparser *parser, argparser_argument *arg,
         }
 
         // Construct value string.
-        string_slice_advance(&value_slice);
+        value_slice.len++;
         index++;
         ss_length++;
       }
 
-      string_slice_to_string(value_slice, &arg_value);
-
-      if (validate_argument_type(parser, arg, arg_value) == 0) {
+      if (validate_argument_type(parser, arg, args_str, value_slice) == 0) {
       } else {
         // Error detected.
       }
 
-      string_slice_destroy(&value_slice);
       break;
     }
     case AP_ARG_STORE_CONST:
@@ -588,41 +825,23 @@ static int validate_argument(argparser *parser, argparser_argument *arg,
  *
  * @param args_str position of the current argument string.
  * @param index position of args_str.
- * @param name buffer to store the name of the argument.
+ * @param name where to store the name of the argument, it points into
+ *             args_str.
  *
- * @return 0 on success,
- *         2 indicates failure to allocation memory for 'str',
- *         4 indicates index is out of bounds.
+ * @return 0 on success, 4 indicates the name runs to the end of args_str.
  */
-static int get_arg_name(char *args_str, unsigned int index, char **name) {
+static int get_arg_name(const char *args_str, unsigned int index,
+                        string_slice *name) {
   int result = STATUS_SUCCESS;
-  string_slice *ss = NULL;
+  string_slice rest = string_slice_from_cstr(args_str + index);
 
-  if (((result = string_slice_create(&ss, args_str + index, 0)) != 0)) {
-    RETURN_DEFER(result);
-  }
+  *name = rest;
 
-  unsigned int args_str_length = strlen(args_str);
-  while (args_str[index] != ' ') {
-    if (index >= args_str_length) {
-      string_slice_to_string(ss, name);
-      RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
-    }
-    string_slice_advance(&ss);
-    index++;
+  if (string_slice_split(&rest, name, ' ') != 0 || rest.ptr == NULL) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
   }
 
-  if ((result = string_slice_to_string(ss, name) != 0)) {
-    RETURN_DEFER(result);
-  }
-
-  string_slice_destroy(&ss);
-
 defer:
-  if (ss != NULL) {
-    string_slice_destroy(&ss);
-  }
-
   return result;
 }
 
@@ -639,35 +858,30 @@ defer:
 static int parse_positional_argument(argparser *parser, char *args_str,
                                      unsigned short index,
                                      unsigned int args_num,
-                                     dynamic_array *pos_args) {
+                                     string_array *pos_args) {
   int result = 0;
   argparser_argument *arg = NULL;
-  char *name = NULL;
+  const char *pos_name = NULL;
+  string_slice name;
 
-  dynamic_array_find_ref_str(pos_args, args_num - 1, (void **)&name);
+  string_array_get(pos_args, args_num - 1, &pos_name, NULL);
 
-  if (name != NULL) {
-    hash_table_search(parser->arguments, name, (void **)&arg);
+  if (pos_name != NULL) {
+    hash_table_search(parser->arguments, pos_name, (void **)&arg);
     index = validate_argument(parser, arg, args_str, index);
     RETURN_DEFER(index);
   }
 
   get_arg_name(args_str, index, &name);
 
-  index += strlen(name);
-
-  // Only allocate memory if unrecognized argument has been detected.
-  if (parser->unrecognized_args == NULL) {
-    string_builder_create(&parser->unrecognized_args);
-  }
-
-  if (arg == NULL && name != NULL) {
-    string_builder_append(parser->unrecognized_args, name, strlen(name));
-    string_builder_append_char(parser->unrecognized_args, ' ');
-    free(name);
+  // Separator left behind by an option that failed, e.g. '-a -b'.
+  if (name.len == 0) {
     RETURN_DEFER(index);
   }
 
+  add_unrecognized_to_parser(parser, token_at(args_str, index), name);
+  RETURN_DEFER(index + name.len);
+
 defer:
   return result;
 }
@@ -681,361 +895,922 @@ defer:
  *
  * @return 0 on success, 1 otherwise.
  */
-static int is_valid_arg_flag(argparser *parser, hash_table *flags, char flag) {
-  int result = STATUS_FAILURE;
-  char flag_str[3];
-  sprintf(flag_str, "-%c", flag);
-  void *long_name = NULL;
-
-  if (hash_table_search(flags, flag_str, &long_name) == 0 &&
-      strncmp(long_name, "--0", 3) != 0) {
-    if (hash_table_search(parser->arguments, long_name, NULL) == 0) {
-      RETURN_DEFER(STATUS_SUCCESS);
-    }
+static int is_valid_arg_flag(argparser *parser, hash_table *flags, char flag) {
+  int result = STATUS_FAILURE;
+  const char flag_str[2] = {'-', flag};
+
+  if (hash_table_search_n(flags, flag_str, 2, NULL) == 0 ||
+      hash_table_search_n(parser->arguments, flag_str, 2, NULL) == 0) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Verify that name is a valid argument name.
+ *
+ * @param parser argparser
+ * @param name Argument name to check.
+ *
+ * @return 0 on success, 1 otherwise.
+ */
+static int is_valid_arg_name(argparser *parser, string_slice name) {
+  int result = STATUS_FAILURE;
+
+  if (hash_table_search_n(parser->arguments, name.ptr, name.len, NULL) == 0) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Retrieve the argument added in a given position.
+ */
+static argparser_argument *arg_at(argparser *parser, unsigned int index) {
+  void *ref = NULL;
+
+  dynamic_array_find_ref(parser->arg_order, index, &ref);
+
+  return *(argparser_argument **)ref;
+}
+
+/**
+ * Check if -h/--help is handled by the parser, it is unless the user added
+ * an argument with either name.
+ */
+static int has_auto_help(argparser *parser) {
+  int size = dynamic_array_get_size(parser->arg_order);
+
+  if (!parser->add_help) {
+    return 0;
+  }
+
+  for (int i = 0; i < size; i++) {
+    argparser_argument *arg = arg_at(parser, i);
+
+    if ((arg->short_name != NULL &&
+         strcmp(arg->short_name, HELP_SHORT_NAME) == 0) ||
+        (arg->long_name != NULL &&
+         strcmp(arg->long_name, HELP_LONG_NAME) == 0)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Check if an option token at a given offset asks for the automatic help.
+ * Tokens after a "--" are not options and never do.
+ *
+ * @param parser argparser
+ * @param args_str concatenated arguments being parsed.
+ * @param index position of the token in args_str.
+ * @param name option name without its value, "-h" or "--help" to match.
+ */
+static int is_help_request(argparser *parser, const char *args_str,
+                           unsigned int index, string_slice name) {
+  if (!string_slice_eq(name, string_slice_from_cstr(HELP_SHORT_NAME)) &&
+      !string_slice_eq(name, string_slice_from_cstr(HELP_LONG_NAME))) {
+    return 0;
+  }
+
+  return has_auto_help(parser) &&
+         token_at(args_str, index) < parser->options_end;
+}
+
+/**
+ * Parse the optional argument.
+ *
+ * @param parser argparser
+ * @param args_str pointer to the start position of argument.
+ * @param arg_kind type of argument,
+ *                 1 is positional,
+ *                 2 is optional with flag,
+ *                 3 is optional with name.
+ *
+ * @return how much to move forward.
+ */
+static int parse_optional_argument(argparser *parser, char *args_str,
+                                   arg_kind kind, unsigned int index,
+                                   hash_table *flags,
+                                   unsigned int args_str_length) {
+  int result = 0;
+  argparser_argument *arg = NULL;
+  argparser_argument **found = NULL;
+  string_slice name;
+  char *error_name = NULL;
+
+  switch (kind) {
+    case ARG_KIND_OPT_FLAG: {
+      char concat_str[3];
+      sprintf(concat_str, "-%c", args_str[index]);
+
+      // Argument flag value cannot be an argument flag.
+      if (index + 1 < args_str_length &&
+          is_valid_arg_flag(parser, flags, args_str[index]) == 0 &&
+          is_valid_arg_flag(parser, flags, args_str[index + 1]) == 0) {
+        add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                            token_at(args_str, index), NULL, concat_str,
+                            "expected one argument");
+        RETURN_DEFER(index);
+      }
+
+      if (hash_table_search_n(flags, concat_str, 2, (void **)&found) == 0) {
+        arg = *found;
+        index = validate_argument(parser, arg, args_str, index + 1);
+        RETURN_DEFER(index);
+      }
+
+      if (is_help_request(parser, args_str, index,
+                          string_slice_make(concat_str, 2))) {
+        parser->help_requested = 1;
+        RETURN_DEFER(++index);
+      }
+
+      add_unrecognized_to_parser(parser, token_at(args_str, index),
+                                 string_slice_make(concat_str, 2));
+
+      RETURN_DEFER(++index);
+      break;
+    }
+    case ARG_KIND_OPT_NAME: {
+      int status = get_arg_name(args_str, index, &name);
+
+      if (is_help_request(parser, args_str, index, name)) {
+        parser->help_requested = 1;
+        RETURN_DEFER(index + name.len);
+      }
+
+      if (status == STATUS_OUT_OF_BOUNDS) {
+        string_slice_to_string(name, &error_name);
+        add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                            token_at(args_str, index), error_name, NULL,
+                            "expected one argument");
+        RETURN_DEFER(strlen(args_str));
+      }
+
+      int name_length = name.len;
+
+      if (hash_table_search_n(parser->arguments, name.ptr, name.len,
+                              (void **)&arg) == 0) {
+        // use name as key to access argument.
+        index = validate_argument(parser, arg, args_str, index + name_length);
+        RETURN_DEFER(index);
+      }
+
+      add_unrecognized_to_parser(parser, token_at(args_str, index), name);
+      index += name_length;
+      RETURN_DEFER(index);
+      break;
+    }
+    default:
+      LOG_ERROR("Should NOT print this message.");
+  }
+
+defer:
+  free(error_name);
+  return result;
+}
+
+/**
+ * Append every required optional argument that was not passed, in JSON
+ * format each one is written as an error record instead.
+ *
+ * @param parser argparser
+ * @param sb where to append the arguments.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int concat_required_optional_arguments(argparser *parser,
+                                              string_builder *sb) {
+  int result = STATUS_SUCCESS;
+  string_slice ss;
+  string_slice output;
+  string_slice flag_slice;
+  string_slice name_slice;
+  const char *opt_args = NULL;
+  argparser_argument *arg = NULL;
+
+  if ((opt_args = string_builder_view(parser->req_opt_args)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  ss = string_slice_trim(string_slice_from_cstr(opt_args));
+
+  while (string_slice_split(&ss, &output, ' ') == 0) {
+    name_slice = output;
+    string_slice_split(&name_slice, &flag_slice, ',');
+
+    arg = find_opt_arg(parser, flag_slice, name_slice);
+
+    if (arg != NULL && arg->value == NULL &&
+        parser->diagnostics_format == AP_DIAGNOSTICS_JSON) {
+      add_error_to_parser(parser, ERROR_MISSING_REQUIRED, -1, arg->short_name,
+                          arg->long_name, "the argument is required");
+    } else if (arg != NULL && arg->value == NULL) {
+      if (arg->short_name != NULL) {
+        string_builder_append(sb, arg->short_name, strlen(arg->short_name));
+      }
+
+      if (arg->short_name != NULL && arg->long_name != NULL) {
+        string_builder_append_char(sb, '/');
+      }
+
+      if (arg->long_name != NULL) {
+        string_builder_append(sb, arg->long_name, strlen(arg->long_name));
+      }
+
+      string_builder_append_char(sb, ' ');
+    }
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Write a record for every missing required argument and close the array
+ * of error records, if there is any.
+ *
+ * @param parser argparser
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int close_error_records(argparser *parser, string_array *pos_args,
+                               unsigned int current_pos_count) {
+  int result = STATUS_SUCCESS;
+
+  if (parser->req_opt_args != NULL) {
+    concat_required_optional_arguments(parser, &parser->diagnostics);
+  }
+
+  for (unsigned int i = current_pos_count; i < parser->pos_args_size; i++) {
+    const char *arg_name = NULL;
+
+    string_array_get(pos_args, i, &arg_name, NULL);
+    add_error_to_parser(parser, ERROR_MISSING_REQUIRED, -1, NULL, arg_name,
+                        "the argument is required");
+  }
+
+  if (parser->json.depth == 0) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  if ((result = json_writer_end_array(&parser->json)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = string_builder_append_char(&parser->diagnostics, '\n');
+
+defer:
+  return result;
+}
+
+/**
+ * Print both argument and unrecognized argument errors.
+ *
+ * Every message is rendered into the parser diagnostics, after the errors
+ * found while parsing. The unrecognized and positional argument lists are
+ * not copied, they are spliced in and the whole text is handed to the sink
+ * in a single writev.
+ *
+ * @param parser argparser
+ *
+ * @return 0 on success,
+ *         1 indicates writing failed,
+ *         2 indicates memory allocation failed.
+ */
+static int print_errors(argparser *parser, string_array *pos_args,
+                        unsigned int current_pos_count) {
+  int result = STATUS_SUCCESS;
+  string_builder *sb = &parser->diagnostics;
+  // Text spliced into the diagnostics, before the character at kept_at.
+  struct iovec kept[2];
+  size_t kept_at[2];
+  int kept_count = 0;
+  struct iovec iov[2 * 2 + 1];
+  int count = 0;
+  size_t start = 0;
+
+  if (parser->diagnostics_format == AP_DIAGNOSTICS_JSON) {
+    if ((result = close_error_records(parser, pos_args, current_pos_count)) !=
+        0) {
+      RETURN_DEFER(result);
+    }
+  } else if (parser->unrecognized_args != NULL) {
+    begin_error(parser);
+    string_builder_append(sb, "unrecognized argument(s): ", 26);
+    kept[kept_count].iov_base = parser->unrecognized_args->data;
+    kept[kept_count].iov_len = parser->unrecognized_args->length;
+    kept_at[kept_count++] = sb->length;
+    end_error(parser);
+  }
+
+  // Missing required optional and positional arguments share one message.
+  if (parser->diagnostics_format == AP_DIAGNOSTICS_TEXT &&
+      ((parser->req_opt_args != NULL &&
+        current_pos_count == parser->pos_args_size) ||
+       current_pos_count < parser->pos_args_size)) {
+    begin_error(parser);
+    string_builder_append(sb, "the following argument(s) are required: ",
+                          40);
+
+    if (parser->req_opt_args != NULL) {
+      // Missing requird optional argument.
+      concat_required_optional_arguments(parser, sb);
+    }
+
+    if (current_pos_count == 0) {
+      // Missing positional argument.
+      kept[kept_count].iov_base = parser->positional_args->data;
+      kept[kept_count].iov_len = parser->positional_args->length;
+      kept_at[kept_count++] = sb->length;
+    } else {
+      for (unsigned int i = current_pos_count; i < parser->pos_args_size; i++) {
+        const char *arg_name = NULL;
+        unsigned int arg_name_length = 0;
+
+        string_array_get(pos_args, i, &arg_name, &arg_name_length);
+        string_builder_append(sb, arg_name, arg_name_length);
+        string_builder_append_char(sb, ' ');
+      }
+    }
+
+    end_error(parser);
+  }
+
+  for (int i = 0; i <= kept_count; i++) {
+    size_t end = i < kept_count ? kept_at[i] : sb->length;
+
+    if (end > start) {
+      iov[count].iov_base = sb->data + start;
+      iov[count++].iov_len = end - start;
+    }
+
+    if (i < kept_count && kept[i].iov_len > 0) {
+      iov[count++] = kept[i];
+    }
+
+    start = end;
+  }
+
+  if ((result = output_sink_writev(parser->sink, iov, count)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = output_sink_flush(parser->sink);
+
+defer:
+  string_builder_clear(sb);
+  json_writer_init(&parser->json, sb);
+  return result;
+}
+
+/**
+ * Check if an argument is positional.
+ */
+static int arg_is_positional(argparser *parser, argparser_argument *arg) {
+  const char *prefix =
+      parser->prefix_chars != NULL ? parser->prefix_chars : "-";
+
+  return arg->short_name == NULL && strchr(prefix, arg->long_name[0]) == NULL;
+}
+
+/**
+ * Check if an argument consumes values from the command line.
+ */
+static int arg_takes_value(argparser_argument *arg) {
+  return arg->action == AP_ARG_STORE || arg->action == AP_ARG_STORE_APPEND ||
+         arg->action == AP_ARG_STORE_EXTEND;
+}
+
+/**
+ * Width of the terminal from COLUMNS or stdout, HELP_DEFAULT_WIDTH when
+ * neither is known.
+ */
+static unsigned int help_terminal_width(void) {
+  const char *columns = getenv("COLUMNS");
+  struct winsize ws;
+
+  if (columns != NULL) {
+    long width = strtol(columns, NULL, 10);
+
+    if (width > 0) {
+      return width;
+    }
+  }
+
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+    return ws.ws_col;
+  }
+
+  return HELP_DEFAULT_WIDTH;
+}
+
+/**
+ * Append 'count' spaces.
+ */
+static void append_spaces(string_builder *sb, size_t count) {
+  if (count > sb->capacity - sb->length &&
+      string_builder_grow(sb, count) != 0) {
+    return;
+  }
+
+  memset(sb->data + sb->length, ' ', count);
+  sb->length += count;
+}
+
+/**
+ * Append text wrapped to 'width' columns, the first line continues the
+ * current one and the others are indented by 'indent' spaces.
+ *
+ * Words are placed greedily so the text is scanned once. Runs of
+ * whitespace collapse to a single space and a word wider than the line
+ * gets a line of its own. Lines are measured in terminal columns, not
+ * bytes, so non ASCII text wraps where it is displayed.
+ */
+static void append_wrapped(string_builder *sb, const char *text,
+                           size_t indent, size_t width) {
+  string_slice rest = string_slice_from_cstr(text);
+  size_t column = 0;
+
+  while (1) {
+    const char *word = NULL;
+    size_t columns = 0;
+    size_t length = string_slice_span(rest, STRING_SLICE_WHITESPACE);
+
+    rest.ptr += length;
+    rest.len -= length;
+
+    if (rest.len == 0) {
+      break;
+    }
+
+    word = rest.ptr;
+    length = string_slice_cspan(rest, STRING_SLICE_WHITESPACE);
+    columns = string_slice_display_width(string_slice_make(word, length));
+    rest.ptr += length;
+    rest.len -= length;
+
+    if (column > 0 && column + 1 + columns > width) {
+      string_builder_append_char(sb, '\n');
+      append_spaces(sb, indent);
+      column = 0;
+    } else if (column > 0) {
+      string_builder_append_char(sb, ' ');
+      column++;
+    }
+
+    string_builder_append(sb, word, length);
+    column += columns;
+  }
+}
+
+/**
+ * Append the name used for the values of an optional argument, its
+ * metavar or its upper cased dest/name without the prefix.
+ */
+static void append_metavar(argparser *parser, string_builder *sb,
+                           argparser_argument *arg) {
+  const char *prefix =
+      parser->prefix_chars != NULL ? parser->prefix_chars : "-";
+  const char *name = NULL;
+
+  if (arg->metavar != NULL) {
+    string_builder_append(sb, arg->metavar, strlen(arg->metavar));
+    return;
+  }
+
+  name = arg->dest != NULL        ? arg->dest
+         : arg->long_name != NULL ? arg->long_name
+                                  : arg->short_name;
+
+  while (*name != '\0' && strchr(prefix, *name) != NULL) {
+    name++;
+  }
+
+  for (; *name != '\0'; name++) {
+    char ch = *name == '-' ? '_' : toupper((unsigned char)*name);
+
+    string_builder_append_char(sb, ch);
+  }
+}
+
+/**
+ * Append the values an optional argument takes as set by its nargs,
+ * e.g. ' N', ' [N]', ' [N ...]', ' N [N ...]'.
+ */
+static void append_values(argparser *parser, string_builder *sb,
+                          argparser_argument *arg) {
+  const char *nargs = arg->nargs;
+
+  if (nargs == NULL) {
+    string_builder_append_char(sb, ' ');
+    append_metavar(parser, sb, arg);
+  } else if (strcmp(nargs, AP_ARG_OPTIONAL) == 0) {
+    string_builder_append(sb, " [", 2);
+    append_metavar(parser, sb, arg);
+    string_builder_append_char(sb, ']');
+  } else if (strcmp(nargs, AP_ARG_ZERO_OR_MORE) == 0) {
+    string_builder_append(sb, " [", 2);
+    append_metavar(parser, sb, arg);
+    string_builder_append(sb, " ...]", 5);
+  } else if (strcmp(nargs, AP_ARG_ONE_OR_MORE) == 0) {
+    string_builder_append_char(sb, ' ');
+    append_metavar(parser, sb, arg);
+    string_builder_append(sb, " [", 2);
+    append_metavar(parser, sb, arg);
+    string_builder_append(sb, " ...]", 5);
+  } else if (strcmp(nargs, AP_ARG_REMAINDER) == 0) {
+    string_builder_append(sb, " ...", 4);
   } else {
-    if (hash_table_search(parser->arguments, flag_str, NULL) == 0) {
-      RETURN_DEFER(STATUS_SUCCESS);
+    long count = strtol(nargs, NULL, 10);
+
+    for (long i = 0; i < count; i++) {
+      string_builder_append_char(sb, ' ');
+      append_metavar(parser, sb, arg);
     }
   }
-
-defer:
-  return result;
 }
 
 /**
- * Verify that name is a valid argument name.
- *
- * @param parser argparser
- * @param name Argument name to check.
- *
- * @return 0 on success, 1 otherwise.
+ * Append how an argument is passed, e.g. 'src' or '-c COPY, --copy COPY'.
  */
-static int is_valid_arg_name(argparser *parser, char *name) {
-  int result = STATUS_FAILURE;
+static void append_invocation(argparser *parser, string_builder *sb,
+                              argparser_argument *arg) {
+  if (arg_is_positional(parser, arg)) {
+    const char *name = arg->metavar != NULL ? arg->metavar
+                       : arg->dest != NULL  ? arg->dest
+                                            : arg->long_name;
 
-  if (hash_table_search(parser->arguments, name, NULL) == 0) {
-    RETURN_DEFER(STATUS_SUCCESS);
+    string_builder_append(sb, name, strlen(name));
+    return;
   }
 
-defer:
-  return result;
+  if (arg->short_name != NULL) {
+    string_builder_append(sb, arg->short_name, strlen(arg->short_name));
+
+    if (arg_takes_value(arg)) {
+      append_values(parser, sb, arg);
+    }
+  }
+
+  if (arg->short_name != NULL && arg->long_name != NULL) {
+    string_builder_append(sb, ", ", 2);
+  }
+
+  if (arg->long_name != NULL) {
+    string_builder_append(sb, arg->long_name, strlen(arg->long_name));
+
+    if (arg_takes_value(arg)) {
+      append_values(parser, sb, arg);
+    }
+  }
 }
 
 /**
- * Parse the optional argument.
- *
- * @param parser argparser
- * @param args_str pointer to the start position of argument.
- * @param arg_kind type of argument,
- *                 1 is positional,
- *                 2 is optional with flag,
- *                 3 is optional with name.
- *
- * @return how much to move forward.
+ * Append the generated usage, optional arguments first then positional
+ * ones, e.g. 'prog [-h] [-c COPY] src'.
  */
-static int parse_optional_argument(argparser *parser, char *args_str,
-                                   arg_kind kind, unsigned int index,
-                                   hash_table *flags,
-                                   unsigned int args_str_length) {
-  int result = 0;
-  argparser_argument *arg = NULL;
-  char *name = NULL;
-  char *value = NULL;
-
-  switch (kind) {
-    case ARG_KIND_OPT_FLAG: {
-      char concat_str[3];
-      sprintf(concat_str, "-%c", args_str[index]);
+static void append_usage(argparser *parser, string_builder *sb,
+                         int auto_help) {
+  int size = dynamic_array_get_size(parser->arg_order);
 
-      // Argument flag value cannot be an argument flag.
-      if (index + 1 < args_str_length &&
-          is_valid_arg_flag(parser, flags, args_str[index]) == 0 &&
-          is_valid_arg_flag(parser, flags, args_str[index + 1]) == 0) {
-        add_error_to_parser(parser, NULL, concat_str, "expected one argument");
-        RETURN_DEFER(index);
-      }
+  if (parser->name != NULL) {
+    string_builder_append_char(sb, ' ');
+    string_builder_append(sb, parser->name, strlen(parser->name));
+  }
 
-      int found = hash_table_search(flags, concat_str, (void **)&value);
-      if (found == 0 && value != NULL && strncmp(value, "--0", 3) != 0) {
-        // use name as key to access argument.
-        hash_table_search(parser->arguments, value, (void **)&arg);
-        index = validate_argument(parser, arg, args_str, index + 1);
-        RETURN_DEFER(index);
-      } else if (found == 0 && strncmp(value, "--0", 3) == 0) {
-        // use flag as key to access argument.
-        hash_table_search(parser->arguments, concat_str, (void **)&arg);
-        index = validate_argument(parser, arg, args_str, index + 1);
-        RETURN_DEFER(index);
-      }
+  if (auto_help) {
+    string_builder_append(sb, " [" HELP_SHORT_NAME "]", 5);
+  }
 
-      // Only allocate memory if unrecognized argument has been detected.
-      if (parser->unrecognized_args == NULL) {
-        string_builder_create(&parser->unrecognized_args);
-      }
+  for (int i = 0; i < size; i++) {
+    argparser_argument *arg = arg_at(parser, i);
+    const char *name =
+        arg->short_name != NULL ? arg->short_name : arg->long_name;
 
-      if (arg == NULL) {
-        string_builder_append_char(parser->unrecognized_args, '-');
-        string_builder_append_char(parser->unrecognized_args, args_str[index]);
-        string_builder_append_char(parser->unrecognized_args, ' ');
-      }
+    if (arg_is_positional(parser, arg)) {
+      continue;
+    }
 
-      RETURN_DEFER(++index);
-      break;
+    // Required optional arguments are not bracketed.
+    if (arg->required) {
+      string_builder_append_char(sb, ' ');
+    } else {
+      string_builder_append(sb, " [", 2);
     }
-    case ARG_KIND_OPT_NAME: {
-      if (get_arg_name(args_str, index, &name) == STATUS_OUT_OF_BOUNDS) {
-        add_error_to_parser(parser, name, NULL, "expected one argument");
-        RETURN_DEFER(strlen(args_str));
-      }
 
-      int name_length = strlen(name);
+    string_builder_append(sb, name, strlen(name));
 
-      if (hash_table_search(parser->arguments, name, (void **)&arg) == 0) {
-        // use name as key to access argument.
-        index = validate_argument(parser, arg, args_str, index + name_length);
-        RETURN_DEFER(index);
-      }
+    if (arg_takes_value(arg)) {
+      append_values(parser, sb, arg);
+    }
 
-      // Only allocate memory if unrecognized argument has been detected.
-      if (parser->unrecognized_args == NULL) {
-        string_builder_create(&parser->unrecognized_args);
-      }
+    if (!arg->required) {
+      string_builder_append_char(sb, ']');
+    }
+  }
 
-      if (arg == NULL) {
-        string_builder_append(parser->unrecognized_args, name, name_length);
-        string_builder_append_char(parser->unrecognized_args, ' ');
-        index += name_length;
-        RETURN_DEFER(index);
-      }
+  for (int i = 0; i < size; i++) {
+    argparser_argument *arg = arg_at(parser, i);
 
-      RETURN_DEFER(++index);
-      break;
+    if (arg_is_positional(parser, arg)) {
+      string_builder_append_char(sb, ' ');
+      append_invocation(parser, sb, arg);
     }
-    default:
-      LOG_ERROR("Should NOT print this message.");
   }
+}
 
-defer:
-  if (name != NULL) {
-    free(name);
+/**
+ * Append one line of the argument list, the invocation in the first column
+ * and the wrapped help in the second. An invocation wider than the first
+ * column puts the help on the next line.
+ */
+static void append_help_entry(string_builder *sb, const char *invocation,
+                              size_t length, const char *help,
+                              size_t position, size_t width) {
+  size_t columns =
+      string_slice_display_width(string_slice_make(invocation, length));
+
+  append_spaces(sb, HELP_INDENT);
+  string_builder_append(sb, invocation, length);
+
+  if (help != NULL && help[0] != '\0') {
+    if (HELP_INDENT + columns + 2 <= position) {
+      append_spaces(sb, position - HELP_INDENT - columns);
+    } else {
+      string_builder_append_char(sb, '\n');
+      append_spaces(sb, position);
+    }
+
+    append_wrapped(sb, help, position, width);
   }
 
-  return result;
+  string_builder_append_char(sb, '\n');
 }
 
 /**
+ * Append the entries of every positional or every optional argument.
  *
+ * @param invocations invocations of every argument one after the other.
+ * @param ends where every invocation ends in 'invocations'.
  */
-static int concat_required_optional_arguments(argparser *parser,
-                                              string_builder **sb,
-                                              unsigned int current_pos_count,
-                                              char **message) {
-  int result = STATUS_SUCCESS;
-
-  string_builder_create(sb);
-
-  string_builder_append(*sb, "the following argument(s) are required: ", 40);
-
-  string_slice *ss = NULL;
-  string_slice *output = NULL;
-  char *opt_args = NULL;
-
-  string_builder_build(parser->req_opt_args, &opt_args);
-
-  if (((result = string_slice_create(&ss, opt_args, strlen(opt_args))) != 0) ||
-      (result = string_slice_create(&output, NULL, 0)) != 0) {
-    RETURN_DEFER(result);
+static void append_help_section(argparser *parser, string_builder *sb,
+                                int positional, const char *invocations,
+                                size_t *ends, size_t position,
+                                size_t width) {
+  int size = dynamic_array_get_size(parser->arg_order);
+
+  for (int i = 0; i < size; i++) {
+    argparser_argument *arg = arg_at(parser, i);
+    size_t start = i == 0 ? 0 : ends[i - 1];
+
+    if (arg_is_positional(parser, arg) == positional) {
+      append_help_entry(sb, invocations + start, ends[i] - start, arg->help,
+                        position, width);
+    }
   }
+}
 
-  string_builder *arg_name = NULL;
-  argparser_argument *arg = NULL;
-  string_slice *flag_slice = NULL;
-  string_slice *name_slice = NULL;
-  char *flag = NULL;
-  char *name = NULL;
-  char *opt_str = NULL;
-
-  string_slice_trim(ss);
+/**
+ * Render the help message for a given width.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int render_help(argparser *parser, unsigned int width, char **help,
+                       size_t *length) {
+  int result = STATUS_SUCCESS;
+  string_builder *invocations = NULL;
+  string_builder sb;
+  size_t *ends = NULL;
+  int size = 0;
+  int auto_help = 0;
+  int num_positional = 0;
+  size_t max_length = 0;
+  size_t text_length = 0;
+  size_t position = 0;
+  size_t help_width = 0;
+  size_t total = 0;
+
+  string_builder_init(&sb, NULL, 0);
+
+  invocations = parser->scratch;
+  size = dynamic_array_get_size(parser->arg_order);
+  auto_help = has_auto_help(parser);
+  max_length = auto_help ? strlen(HELP_AUTO_INVOCATION) : 0;
+
+  if ((ends = malloc(sizeof(size_t) * (size + 1))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
 
-  while (string_slice_split(ss, output, ' ') == 0) {
-    string_slice_to_string(output, &opt_str);
-    string_slice_create(&name_slice, opt_str, strlen(opt_str));
-    string_slice_create(&flag_slice, NULL, 0);
-    string_slice_split(name_slice, flag_slice, ',');
-    string_slice_to_string(flag_slice, &flag);
-    string_slice_to_string(name_slice, &name);
+  // Single pass over the arguments: render every invocation once, keeping
+  // the widest for the first column, and total the help text.
+  string_builder_clear(invocations);
 
-    if (strncmp(flag, "-0", 2) != 0 && strncmp(name, "--0", 3) == 0) {
-      // flag found.
-      hash_table_search(parser->arguments, flag, (void *)&arg);
+  for (int i = 0; i < size; i++) {
+    argparser_argument *arg = arg_at(parser, i);
+    size_t start = invocations->length;
+    size_t columns = 0;
 
-      if (arg->value == NULL) {
-        char *concat_str = NULL;
+    append_invocation(parser, invocations, arg);
+    ends[i] = invocations->length;
+    columns = string_slice_display_width(
+        string_slice_make(invocations->data + start, ends[i] - start));
 
-        string_builder_create(&arg_name);
+    if (columns > max_length) {
+      max_length = columns;
+    }
 
-        if (arg->short_name != NULL) {
-          string_builder_append_fmtstr(arg_name, "%s", arg->short_name);
-        }
+    if (arg->help != NULL) {
+      text_length += strlen(arg->help);
+    }
 
-        if (arg->short_name != NULL && arg->long_name != NULL) {
-          string_builder_append_char(arg_name, '/');
-        }
+    num_positional += arg_is_positional(parser, arg);
+  }
 
-        if (arg->long_name != NULL) {
-          string_builder_append_fmtstr(arg_name, "%s", arg->long_name);
-        }
+  position = max_length + HELP_INDENT + 2;
+  position = position < HELP_MAX_POSITION ? position : HELP_MAX_POSITION;
+  help_width = width > position + HELP_MIN_WIDTH ? width - position
+                                                 : HELP_MIN_WIDTH;
 
-        string_builder_append_char(arg_name, ' ');
+  if (parser->description != NULL) {
+    text_length += strlen(parser->description);
+  }
 
-        string_builder_build(arg_name, &concat_str);
+  if (parser->epilogue != NULL) {
+    text_length += strlen(parser->epilogue);
+  }
 
-        string_builder_append(*sb, concat_str, strlen(concat_str));
-        free(concat_str);
-      }
-      //} else if (strncmp(name, "--0", 3) != 0 && strncmp(flag, "-0", 2) ==
-      // 0) {
-      // name found.
-    } else {
-      // flag and name are defined.
-      hash_table_search(parser->arguments, name, (void *)&arg);
+  // Upper bound of the whole message so it is written without growing.
+  // Two consecutive wrapped lines hold at least help_width columns, and
+  // text never takes more columns than bytes, so text wraps to at most
+  // 2 * text_length / help_width + 1 lines per text.
+  total = sizeof("usage:") + sizeof(" [" HELP_SHORT_NAME "]") +
+          (parser->name != NULL ? strlen(parser->name) + 1 : 0) +
+          (parser->usage != NULL ? strlen(parser->usage) + 1 : 0) +
+          2 * invocations->length + (size_t)size * 4 +
+          sizeof("\n\npositional arguments:\n\noptions:\n\n") +
+          (size_t)(size + 1) * (position + 2) +
+          HELP_INDENT + strlen(HELP_AUTO_INVOCATION HELP_AUTO_TEXT) +
+          text_length +
+          (2 * text_length / help_width + (size_t)size + 4) * (position + 1);
 
-      if (arg->value == NULL) {
-        char *concat_str = NULL;
+  if (string_builder_reserve(&sb, total) != 0) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
 
-        string_builder_create(&arg_name);
+  string_builder_append(&sb, "usage:", 6);
 
-        if (arg->short_name != NULL) {
-          string_builder_append_fmtstr(arg_name, "%s", arg->short_name);
-        }
+  if (parser->usage != NULL) {
+    string_builder_append_char(&sb, ' ');
+    string_builder_append(&sb, parser->usage, strlen(parser->usage));
+  } else {
+    append_usage(parser, &sb, auto_help);
+  }
 
-        if (arg->short_name != NULL && arg->long_name != NULL) {
-          string_builder_append_char(arg_name, '/');
-        }
+  string_builder_append_char(&sb, '\n');
 
-        if (arg->long_name != NULL) {
-          string_builder_append_fmtstr(arg_name, "%s", arg->long_name);
-        }
+  if (parser->description != NULL) {
+    string_builder_append_char(&sb, '\n');
+    append_wrapped(&sb, parser->description, 0, width);
+    string_builder_append_char(&sb, '\n');
+  }
 
-        string_builder_append_char(arg_name, ' ');
+  if (num_positional > 0) {
+    string_builder_append(&sb, "\npositional arguments:\n", 23);
+    append_help_section(parser, &sb, 1, invocations->data, ends, position,
+                        help_width);
+  }
 
-        string_builder_build(arg_name, &concat_str);
+  if (auto_help || num_positional < size) {
+    string_builder_append(&sb, "\noptions:\n", 10);
 
-        string_builder_append(*sb, concat_str, strlen(concat_str));
-        free(concat_str);
-      }
+    if (auto_help) {
+      append_help_entry(&sb, HELP_AUTO_INVOCATION,
+                        strlen(HELP_AUTO_INVOCATION), HELP_AUTO_TEXT,
+                        position, help_width);
     }
 
-    string_builder_destroy(&arg_name);
-    string_slice_destroy(&flag_slice);
-    string_slice_destroy(&name_slice);
-    free(flag);
-    flag = NULL;
-    free(name);
-    name = NULL;
-    free(opt_str);
-    opt_str = NULL;
+    append_help_section(parser, &sb, 0, invocations->data, ends, position,
+                        help_width);
   }
 
-  if (current_pos_count == parser->pos_args_size) {
-    string_builder_build(*sb, message);
-    LOG_ERROR("%s", *message);
+  if (parser->epilogue != NULL) {
+    string_builder_append_char(&sb, '\n');
+    append_wrapped(&sb, parser->epilogue, 0, width);
+    string_builder_append_char(&sb, '\n');
   }
 
-  string_slice_destroy(&ss);
-  string_slice_destroy(&output);
-  free(opt_args);
+  *length = sb.length;
+  result = string_builder_steal(&sb, help);
+
 defer:
+  string_builder_release(&sb);
+
+  if (ends != NULL) {
+    free(ends);
+  }
+
   return result;
 }
 
-/**
- * Print both argument and unrecognized argument errors.
- *
- * @param parser argparser
- *
- * @return 0 on success,
- *         1 indicates failure to build string,
- *         2 indicates memory allocation failed.
- */
-static int print_errors(argparser *parser, dynamic_array *pos_args,
-                        unsigned int current_pos_count) {
+int argparser_get_help(argparser *parser, unsigned int width,
+                       const char **help, size_t *length) {
   int result = STATUS_SUCCESS;
-  dynamic_array_iter *it = NULL;
 
-  if (parser->errors != NULL) {
-    char *message = NULL;
+  if (parser == NULL || help == NULL || length == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
 
-    if ((result = dynamic_array_iter_create(&it, parser->errors) != 0)) {
-      RETURN_DEFER(result);
-    }
+  if (parser->static_help != NULL) {
+    *help = parser->static_help;
+    *length = strlen(parser->static_help);
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
 
-    while (dynamic_array_iter_next_str(it, &message) == 0) {
-      LOG_ERROR("%s", message);
-    }
+  if (width == 0) {
+    width = help_terminal_width();
   }
 
-  if (parser->unrecognized_args != NULL) {
-    char *args = NULL;
+  if (parser->help_cache == NULL || parser->help_cache_width != width) {
+    char *rendered = NULL;
+    size_t rendered_length = 0;
 
-    if ((result = string_builder_build(parser->unrecognized_args, &args)) !=
+    if ((result = render_help(parser, width, &rendered, &rendered_length)) !=
         0) {
       RETURN_DEFER(result);
     }
 
-    LOG_ERROR("unrecognized argument(s): %s", args);
-    free(args);
+    free(parser->help_cache);
+    parser->help_cache = rendered;
+    parser->help_cache_length = rendered_length;
+    parser->help_cache_width = width;
   }
 
-  string_builder *sb = NULL;
-  char *message = NULL;
+  *help = parser->help_cache;
+  *length = parser->help_cache_length;
 
-  if (parser->req_opt_args != NULL) {
-    // Missing requird optional argument.
-    concat_required_optional_arguments(parser, &sb, current_pos_count,
-                                       &message);
-  }
+defer:
+  return result;
+}
 
-  if (current_pos_count < parser->pos_args_size) {
-    // Missing positional argument.
+int argparser_format_help(argparser *parser, unsigned int width,
+                          char **help) {
+  int result = STATUS_SUCCESS;
+  const char *cached = NULL;
+  size_t length = 0;
 
-    if (parser->req_opt_args == NULL) {
-      string_builder_create(&sb);
-      string_builder_append(sb, "the following argument(s) are required: ", 40);
-    }
+  if ((result = argparser_get_help(parser, width, &cached, &length)) != 0) {
+    RETURN_DEFER(result);
+  }
 
-    if (current_pos_count == 0) {
-      char *str = NULL;
+  if ((*help = malloc(length + 1)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
 
-      string_builder_build(parser->positional_args, &str);
-      string_builder_append(sb, str, strlen(str));
-      free(str);
-    } else {
-      for (unsigned int i = current_pos_count; i < parser->pos_args_size; i++) {
-        char *arg_name = NULL;
+  memcpy(*help, cached, length + 1);
 
-        dynamic_array_find_ref_str(pos_args, i, (void **)&arg_name);
-        string_builder_append(sb, arg_name, strlen(arg_name));
-        string_builder_append_char(sb, ' ');
-      }
-    }
+defer:
+  return result;
+}
 
-    string_builder_build(sb, &message);
+int argparser_print_help(argparser *parser, output_sink *sink) {
+  int result = STATUS_SUCCESS;
+  output_sink *out = sink;
+  const char *help = NULL;
+  size_t length = 0;
 
-    LOG_ERROR("%s", message);
+  if ((result = argparser_get_help(parser, 0, &help, &length)) != 0) {
+    RETURN_DEFER(result);
   }
 
-defer:
-  if (it != NULL) {
-    dynamic_array_iter_destroy(&it);
+  if (out == NULL) {
+    // Keep the order of anything already printed through stdio.
+    fflush(stdout);
+
+    if ((result = output_sink_create_fd(&out, STDOUT_FILENO)) != 0) {
+      RETURN_DEFER(result);
+    }
   }
 
-  if (sb != NULL) {
-    string_builder_destroy(&sb);
+  // A file descriptor sink writes the cached help without copying it.
+  if ((result = output_sink_writev(
+           out, &(struct iovec){.iov_base = (char *)help, .iov_len = length},
+           1)) != 0) {
+    RETURN_DEFER(result);
   }
 
-  if (message != NULL) {
-    free(message);
+  result = output_sink_flush(out);
+
+defer:
+  if (sink == NULL && out != NULL) {
+    output_sink_destroy(&out);
   }
 
   return result;
@@ -1062,17 +1837,40 @@ int argparser_create(argparser **parser) {
     RETURN_DEFER(result);
   }
 
+  if ((result = string_builder_create(&(*parser)->scratch)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = output_sink_create_fd(&(*parser)->sink, STDERR_FILENO)) !=
+      0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = dynamic_array_create(&(*parser)->arg_order,
+                                     sizeof(argparser_argument *), NULL,
+                                     NULL)) != 0) {
+    RETURN_DEFER(result);
+  }
+
   (*parser)->name = NULL;
   (*parser)->usage = NULL;
   (*parser)->description = NULL;
   (*parser)->epilogue = NULL;
   (*parser)->prefix_chars = NULL;
+  (*parser)->static_help = NULL;
+  (*parser)->help_cache = NULL;
+  (*parser)->help_cache_length = 0;
+  (*parser)->help_cache_width = 0;
   (*parser)->add_help = true;
   (*parser)->allow_abbrev = true;
+  (*parser)->strict_utf8 = false;
+  (*parser)->owns_sink = true;
   (*parser)->pos_args_size = 0;
   (*parser)->req_opt_args_size = 0;
   (*parser)->unrecognized_args = NULL;
-  (*parser)->errors = NULL;
+  string_builder_init(&(*parser)->diagnostics, NULL, 0);
+  json_writer_init(&(*parser)->json, &(*parser)->diagnostics);
+  (*parser)->diagnostics_format = AP_DIAGNOSTICS_TEXT;
   (*parser)->req_opt_args = NULL;
 
 defer:
@@ -1125,6 +1923,16 @@ defer:
   return result;
 }
 
+int argparser_add_static_help_to_argparser(argparser **parser,
+                                           const char *static_help) {
+  int result = STATUS_SUCCESS;
+
+  ADD_PROP_TO_PARSER(parser, static_help);
+
+defer:
+  return result;
+}
+
 int argparser_add_help_to_argparser(argparser **parser, bool add_help) {
   int result = STATUS_SUCCESS;
 
@@ -1133,6 +1941,7 @@ int argparser_add_help_to_argparser(argparser **parser, bool add_help) {
   }
 
   (*parser)->add_help = add_help;
+  invalidate_help(*parser);
 
 defer:
   return result;
@@ -1150,6 +1959,49 @@ defer:
   return result;
 }
 
+int argparser_add_strict_utf8_to_argparser(argparser **parser,
+                                           bool strict_utf8) {
+  int result = STATUS_SUCCESS;
+
+  if (strict_utf8 != 0 && strict_utf8 != 1) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  (*parser)->strict_utf8 = strict_utf8;
+defer:
+  return result;
+}
+
+int argparser_add_diagnostics_format_to_argparser(
+    argparser **parser, argparser_diagnostics_format format) {
+  int result = STATUS_SUCCESS;
+
+  if (format != AP_DIAGNOSTICS_TEXT && format != AP_DIAGNOSTICS_JSON) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  (*parser)->diagnostics_format = format;
+defer:
+  return result;
+}
+
+int argparser_add_sink_to_argparser(argparser **parser, output_sink *sink) {
+  int result = STATUS_SUCCESS;
+
+  if (sink == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((*parser)->owns_sink) {
+    output_sink_destroy(&(*parser)->sink);
+  }
+
+  (*parser)->sink = sink;
+  (*parser)->owns_sink = false;
+defer:
+  return result;
+}
+
 int argparser_add_argument(argparser *parser, char short_name[2],
                            char *long_name) {
   int result = STATUS_SUCCESS;
@@ -1183,6 +2035,7 @@ int argparser_add_argument(argparser *parser, char short_name[2],
     }
 
     hash_table_insert(parser->arguments, long_name, arg);
+    dynamic_array_add(parser->arg_order, &arg);
 
     parser->pos_args_size++;
   } else if (arg_kind == 2) {
@@ -1211,6 +2064,7 @@ int argparser_add_argument(argparser *parser, char short_name[2],
     }
 
     hash_table_insert(parser->arguments, short_name, arg);
+    dynamic_array_add(parser->arg_order, &arg);
   } else if (arg_kind == 3) {
     // Optional argument with long_name as key.
 
@@ -1237,11 +2091,14 @@ int argparser_add_argument(argparser *parser, char short_name[2],
     }
 
     hash_table_insert(parser->arguments, long_name, arg);
+    dynamic_array_add(parser->arg_order, &arg);
   } else {
     // Argument formatting error.
     RETURN_DEFER(STATUS_FAILURE);
   }
 
+  invalidate_help(parser);
+
 defer:
   return result;
 }
@@ -1288,6 +2145,7 @@ int argparser_add_action_to_arg(argparser *parser, char *name_or_flag,
       RETURN_DEFER(STATUS_FAILURE);
   }
   arg->action = action_value;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1331,6 +2189,7 @@ int argparser_add_help_to_arg(argparser *parser, char *name_or_flag,
 
   // TODO: malloc here
   arg->help = help;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1388,6 +2247,7 @@ int argparser_add_required_to_arg(argparser *parser, char *name_or_flag,
 
   // TODO: malloc here
   arg->required = required;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1420,6 +2280,7 @@ int argparser_add_dest_to_arg(argparser *parser, char *name_or_flag,
 
   // TODO: malloc here
   arg->dest = dest;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1434,6 +2295,7 @@ int argparser_add_nargs_to_arg(argparser *parser, char *name_or_flag,
 
   // TODO: malloc here
   arg->nargs = nargs;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1448,6 +2310,7 @@ int argparser_add_metavar_to_arg(argparser *parser, char *name_or_flag,
 
   // TODO: malloc here
   arg->metavar = metavar;
+  invalidate_help(parser);
 
 defer:
   return result;
@@ -1500,9 +2363,29 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
   char *args_str = NULL;
   unsigned int current_pos_count = 0;
   hash_table *flags = NULL;
-  dynamic_array *pos_args = NULL;
+  string_array *pos_args = NULL;
+
+  if (parser->name == NULL && argc > 0) {
+    parser->name = argv[0];
+    // The usage line shows the name.
+    invalidate_help(parser);
+  }
+
+  // -h/--help only counts as an option before "--".
+  parser->help_requested = 0;
+  parser->options_end = argc;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--") == 0) {
+      parser->options_end = i;
+      break;
+    }
+  }
+
+  if (parser->strict_utf8) {
+    validate_utf8_args(parser, argc, argv);
+  }
 
-  if ((result = concat_argv(argc, argv, &args_str)) != 0) {
+  if ((result = concat_argv(parser, argc, argv, &args_str)) != 0) {
     RETURN_DEFER(result);
   }
 
@@ -1516,36 +2399,54 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
 
   int args_length = strlen(args_str);
   for (int i = 0; i < args_length; i++) {
-    if ((strncmp(args_str + i, "--", 2)) == 0) {
+    if (args_str[i] == ' ') {
+      // A branch that stops early leaves i on the separator, it does not
+      // start a positional argument.
+      continue;
+    } else if ((strncmp(args_str + i, "--", 2)) == 0) {
       // Optional name argument.
-      char *name = NULL;
+      string_slice name;
       get_arg_name(args_str, i, &name);
-      int name_length = strlen(name);
+      int name_length = name.len;
 
       if (is_valid_arg_name(parser, name) == 0 &&
           i + name_length + 1 < args_length &&
           args_str[i + name_length + 1] == '-') {
         // Argument name value cannot conflict with another argument flag.
-        add_error_to_parser(parser, name, NULL, "expected one argument");
+        char *error_name = NULL;
+
+        string_slice_to_string(name, &error_name);
+        add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                            token_at(args_str, i), error_name, NULL,
+                            "expected one argument");
         i += name_length;
-        free(name);
+        free(error_name);
         continue;
       }
 
-      free(name);
-
       i = parse_optional_argument(parser, args_str, ARG_KIND_OPT_NAME, i, flags,
                                   args_length);
     } else if (args_str[i] == '-') {
       char concat_str[3];
       sprintf(concat_str, "-%c", args_str[i + 1]);
 
+      // Help is asked for whatever follows, the rest of the token included.
+      if (is_help_request(parser, args_str, i,
+                          string_slice_make(concat_str, 2))) {
+        parser->help_requested = 1;
+        while (i < args_length && args_str[i] != ' ') {
+          i++;
+        }
+        continue;
+      }
+
       // Optional flag argument.
       while (args_str[i] != ' ' && i < args_length) {
         if (i + 2 < args_length && strncmp(args_str + i + 2, "--", 2) == 0) {
           // Argument flag value cannot conflict with another argument's name.
           // example, '-a--name'
-          add_error_to_parser(parser, NULL, concat_str,
+          add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                              token_at(args_str, i), NULL, concat_str,
                               "expected one argument");
           i++;
           break;
@@ -1553,7 +2454,8 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
                    strncmp(args_str + i + 3, "--", 2) == 0) {
           // Same as above but seperated by a space.
           // example, '-a --name'
-          add_error_to_parser(parser, NULL, concat_str,
+          add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                              token_at(args_str, i), NULL, concat_str,
                               "expected one argument");
           i++;
           break;
@@ -1563,7 +2465,8 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
                    is_valid_arg_flag(parser, flags, args_str[i + 1]) == 0) {
           // Argument flag value cannot conflict with another argument's flag.
           // example, '-a-b'
-          add_error_to_parser(parser, NULL, concat_str,
+          add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                              token_at(args_str, i), NULL, concat_str,
                               "expected one argument");
           i++;
           break;
@@ -1573,7 +2476,8 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
                    is_valid_arg_flag(parser, flags, args_str[i + 1]) == 0) {
           // Argument flag value cannot conflict with another argument's flag.
           // example, '-a -b'
-          add_error_to_parser(parser, NULL, concat_str,
+          add_error_to_parser(parser, ERROR_EXPECTED_ARGUMENT,
+                              token_at(args_str, i), NULL, concat_str,
                               "expected one argument");
           i++;
           break;
@@ -1594,7 +2498,14 @@ int argparser_parse_args(argparser *parser, int argc, char *argv[]) {
     }
   }
 
-  if (parser->errors != NULL || parser->unrecognized_args != NULL ||
+  if (parser->help_requested) {
+    // The caller prints the help, errors found so far no longer matter.
+    string_builder_clear(&parser->diagnostics);
+    json_writer_init(&parser->json, &parser->diagnostics);
+    RETURN_DEFER(AP_HELP_REQUESTED);
+  }
+
+  if (parser->diagnostics.length > 0 || parser->unrecognized_args != NULL ||
       current_pos_count < parser->pos_args_size ||
       parser->req_opt_args != NULL) {
     print_errors(parser, pos_args, current_pos_count);
@@ -1606,7 +2517,7 @@ defer:
   }
 
   if (pos_args != NULL) {
-    dynamic_array_destroy(&pos_args);
+    string_array_destroy(&pos_args);
   }
 
   if (args_str != NULL) {
@@ -1622,14 +2533,19 @@ void argparser_destroy(argparser **parser) {
     string_builder_destroy(&(*parser)->positional_args);
     string_builder_destroy(&(*parser)->optional_args);
     string_builder_destroy(&(*parser)->req_opt_args);
+    string_builder_destroy(&(*parser)->scratch);
+    dynamic_array_destroy(&(*parser)->arg_order);
+    invalidate_help(*parser);
+
+    if ((*parser)->owns_sink) {
+      output_sink_destroy(&(*parser)->sink);
+    }
 
     if ((*parser)->unrecognized_args != NULL) {
       string_builder_destroy(&(*parser)->unrecognized_args);
     }
 
-    if ((*parser)->errors != NULL) {
-      dynamic_array_destroy(&(*parser)->errors);
-    }
+    string_builder_release(&(*parser)->diagnostics);
 
     free(*parser);
     *parser = NULL;
@@ -0,0 +1,311 @@
+#include "bitset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define BITSET_WORD_BITS 64
+#define BITSET_WORDS(bits) (((bits) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+#define BITSET_WORD_INDEX(bit) ((bit) / BITSET_WORD_BITS)
+#define BITSET_BIT_MASK(bit) (1ULL << ((bit) % BITSET_WORD_BITS))
+
+struct bitset {
+  unsigned long long *words;
+  unsigned int size;      // Number of bits.
+  unsigned int capacity;  // Number of words allocated.
+  int growable;           // Grow instead of failing on out of bounds.
+};
+
+/**
+ * Allocate the bitset with all bits cleared.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int bitset_init(bitset **bs, unsigned int num_bits, int growable) {
+  int result = STATUS_SUCCESS;
+
+  if ((*bs = malloc(sizeof(bitset))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  (*bs)->size = num_bits;
+  (*bs)->capacity = BITSET_WORDS(num_bits);
+  (*bs)->growable = growable;
+  (*bs)->words = NULL;
+
+  if ((*bs)->capacity > 0 &&
+      ((*bs)->words = calloc((*bs)->capacity, sizeof(unsigned long long))) ==
+          NULL) {
+    free(*bs);
+    *bs = NULL;
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Grow the bitset to hold at least num_bits bits.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int bitset_grow(bitset *bs, unsigned int num_bits) {
+  int result = STATUS_SUCCESS;
+  unsigned int words = BITSET_WORDS(num_bits);
+
+  if (words > bs->capacity) {
+    unsigned int capacity = bs->capacity == 0 ? 1 : bs->capacity;
+    unsigned long long *new_words = NULL;
+
+    while (capacity < words) {
+      capacity <<= 1;
+    }
+
+    if ((new_words = realloc(bs->words,
+                             capacity * sizeof(unsigned long long))) == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    // since realloc doesn't zero out new space allocated,
+    // it is done manually.
+    memset(new_words + bs->capacity, 0,
+           (capacity - bs->capacity) * sizeof(unsigned long long));
+
+    bs->words = new_words;
+    bs->capacity = capacity;
+  }
+
+  if (num_bits > bs->size) {
+    bs->size = num_bits;
+  }
+
+defer:
+  return result;
+}
+
+int bitset_create(bitset **bs, unsigned int num_bits) {
+  return bitset_init(bs, num_bits, 0);
+}
+
+int bitset_create_growable(bitset **bs, unsigned int num_bits) {
+  return bitset_init(bs, num_bits, 1);
+}
+
+int bitset_get_size(bitset *bs) {
+  if (bs == NULL) {
+    return -1;
+  }
+  return bs->size;
+}
+
+int bitset_set(bitset *bs, unsigned int index) {
+  int result = STATUS_SUCCESS;
+
+  if (bs == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (index >= bs->size) {
+    if (!bs->growable) {
+      RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+    }
+
+    if ((result = bitset_grow(bs, index + 1)) != 0) {
+      RETURN_DEFER(result);
+    }
+  }
+
+  bs->words[BITSET_WORD_INDEX(index)] |= BITSET_BIT_MASK(index);
+
+defer:
+  return result;
+}
+
+int bitset_clear(bitset *bs, unsigned int index) {
+  int result = STATUS_SUCCESS;
+
+  if (bs == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (index >= bs->size) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  bs->words[BITSET_WORD_INDEX(index)] &= ~BITSET_BIT_MASK(index);
+
+defer:
+  return result;
+}
+
+int bitset_test(bitset *bs, unsigned int index) {
+  if (bs == NULL || index >= bs->size) {
+    return 0;
+  }
+  return (bs->words[BITSET_WORD_INDEX(index)] & BITSET_BIT_MASK(index)) != 0;
+}
+
+void bitset_clear_all(bitset *bs) {
+  if (bs != NULL && bs->words != NULL) {
+    memset(bs->words, 0, bs->capacity * sizeof(unsigned long long));
+  }
+}
+
+int bitset_or(bitset *dest, bitset *src) {
+  int result = STATUS_SUCCESS;
+
+  if (dest == NULL || src == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (dest->growable && src->size > dest->size) {
+    if ((result = bitset_grow(dest, src->size)) != 0) {
+      RETURN_DEFER(result);
+    }
+  }
+
+  unsigned int words = BITSET_WORDS(dest->size);
+  unsigned int src_words = BITSET_WORDS(src->size);
+  unsigned int length = words < src_words ? words : src_words;
+
+  for (unsigned int i = 0; i < length; i++) {
+    dest->words[i] |= src->words[i];
+  }
+
+  // Drop bits of the last word past the size of a fixed dest.
+  if (length == words && dest->size % BITSET_WORD_BITS != 0) {
+    dest->words[words - 1] &= BITSET_BIT_MASK(dest->size) - 1;
+  }
+
+defer:
+  return result;
+}
+
+int bitset_and(bitset *dest, bitset *src) {
+  int result = STATUS_SUCCESS;
+
+  if (dest == NULL || src == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  unsigned int words = BITSET_WORDS(dest->size);
+  unsigned int src_words = BITSET_WORDS(src->size);
+
+  for (unsigned int i = 0; i < words; i++) {
+    dest->words[i] &= i < src_words ? src->words[i] : 0;
+  }
+
+defer:
+  return result;
+}
+
+int bitset_andnot(bitset *dest, bitset *src) {
+  int result = STATUS_SUCCESS;
+
+  if (dest == NULL || src == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  unsigned int words = BITSET_WORDS(dest->size);
+  unsigned int src_words = BITSET_WORDS(src->size);
+  unsigned int length = words < src_words ? words : src_words;
+
+  for (unsigned int i = 0; i < length; i++) {
+    dest->words[i] &= ~src->words[i];
+  }
+
+defer:
+  return result;
+}
+
+unsigned int bitset_count(bitset *bs) {
+  unsigned int count = 0;
+
+  if (bs == NULL) {
+    return 0;
+  }
+
+  for (unsigned int i = 0; i < BITSET_WORDS(bs->size); i++) {
+    count += __builtin_popcountll(bs->words[i]);
+  }
+
+  return count;
+}
+
+int bitset_intersects(bitset *a, bitset *b) {
+  if (a == NULL || b == NULL) {
+    return 0;
+  }
+
+  unsigned int a_words = BITSET_WORDS(a->size);
+  unsigned int b_words = BITSET_WORDS(b->size);
+  unsigned int length = a_words < b_words ? a_words : b_words;
+
+  for (unsigned int i = 0; i < length; i++) {
+    if ((a->words[i] & b->words[i]) != 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int bitset_is_subset(bitset *a, bitset *b) {
+  if (a == NULL || b == NULL) {
+    return 0;
+  }
+
+  unsigned int a_words = BITSET_WORDS(a->size);
+  unsigned int b_words = BITSET_WORDS(b->size);
+
+  for (unsigned int i = 0; i < a_words; i++) {
+    if ((a->words[i] & ~(i < b_words ? b->words[i] : 0)) != 0) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int bitset_find_first(bitset *bs, unsigned int start, unsigned int *index) {
+  int result = STATUS_FAILURE;
+
+  if (bs == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (start >= bs->size) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  unsigned int words = BITSET_WORDS(bs->size);
+  unsigned int i = BITSET_WORD_INDEX(start);
+  // Ignore the bits before start in the first word.
+  unsigned long long word = bs->words[i] & ~(BITSET_BIT_MASK(start) - 1);
+
+  while (1) {
+    if (word != 0) {
+      *index = i * BITSET_WORD_BITS + __builtin_ctzll(word);
+      RETURN_DEFER(STATUS_SUCCESS);
+    }
+
+    if (++i >= words) {
+      break;
+    }
+
+    word = bs->words[i];
+  }
+
+defer:
+  return result;
+}
+
+void bitset_destroy(bitset **bs) {
+  if (*bs != NULL) {
+    free((*bs)->words);
+    free(*bs);
+    *bs = NULL;
+  }
+}
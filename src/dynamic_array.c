@@ -3,7 +3,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "logger.h"
+#include "thread_pool.h"
 
 struct dynamic_array {
   void **items;
@@ -22,6 +27,15 @@ struct dynamic_array_iter {
 };
 
 #define DYNAMIC_ARRAY_INTIAL_CAPACITY 8
+// Ranges smaller than this are sorted with insertion sort.
+#define DYNAMIC_ARRAY_SORT_THRESHOLD 16
+// Buckets smaller than this are sorted with insertion sort.
+#define DYNAMIC_ARRAY_RADIX_THRESHOLD 32
+// How many strings ahead radix sort prefetches.
+#define DYNAMIC_ARRAY_PREFETCH_DISTANCE 64
+
+#define ELEMENT_AT(base, index, size) \
+  ((char *)(base) + (size_t)(index) * (size))
 
 /**
  * Resize the dynamic array after capacity has been reached/exceeded.
@@ -287,6 +301,960 @@ defer:
   return result;
 }
 
+/**
+ * Swap two elements byte by byte.
+ */
+static void swap_elements(char *a, char *b, unsigned int size) {
+  while (size-- > 0) {
+    char temp = *a;
+    *a++ = *b;
+    *b++ = temp;
+  }
+}
+
+/**
+ * Sort elements in the range [lo, hi) using insertion sort.
+ */
+static void insertion_sort(char *base, unsigned int lo, unsigned int hi,
+                           unsigned int size, int (*cmpfn)(void *, void *)) {
+  for (unsigned int i = lo + 1; i < hi; i++) {
+    for (unsigned int j = i; j > lo; j--) {
+      char *prev = ELEMENT_AT(base, j - 1, size);
+      char *current = ELEMENT_AT(base, j, size);
+
+      if (cmpfn(prev, current) <= 0) {
+        break;
+      }
+
+      swap_elements(prev, current, size);
+    }
+  }
+}
+
+/**
+ * Move element at index down the heap until the heap property is restored.
+ */
+static void sift_down(char *base, unsigned int index, unsigned int length,
+                      unsigned int size, int (*cmpfn)(void *, void *)) {
+  while (1) {
+    unsigned int largest = index;
+    unsigned int left = 2 * index + 1;
+    unsigned int right = left + 1;
+
+    if (left < length && cmpfn(ELEMENT_AT(base, left, size),
+                               ELEMENT_AT(base, largest, size)) > 0) {
+      largest = left;
+    }
+
+    if (right < length && cmpfn(ELEMENT_AT(base, right, size),
+                                ELEMENT_AT(base, largest, size)) > 0) {
+      largest = right;
+    }
+
+    if (largest == index) {
+      return;
+    }
+
+    swap_elements(ELEMENT_AT(base, index, size),
+                  ELEMENT_AT(base, largest, size), size);
+    index = largest;
+  }
+}
+
+/**
+ * Sort length elements using heapsort.
+ */
+static void heap_sort(char *base, unsigned int length, unsigned int size,
+                      int (*cmpfn)(void *, void *)) {
+  for (unsigned int i = length / 2; i > 0; i--) {
+    sift_down(base, i - 1, length, size, cmpfn);
+  }
+
+  for (unsigned int end = length - 1; end > 0; end--) {
+    swap_elements(base, ELEMENT_AT(base, end, size), size);
+    sift_down(base, 0, end, size, cmpfn);
+  }
+}
+
+/**
+ * Sort elements in the range [lo, hi) using introsort.
+ *
+ * @param depth number of partitions left before switching to heapsort.
+ */
+static void intro_sort(char *base, unsigned int lo, unsigned int hi,
+                       unsigned int size, int (*cmpfn)(void *, void *),
+                       unsigned int depth) {
+  while (hi - lo > DYNAMIC_ARRAY_SORT_THRESHOLD) {
+    if (depth == 0) {
+      heap_sort(ELEMENT_AT(base, lo, size), hi - lo, size, cmpfn);
+      return;
+    }
+    depth--;
+
+    char *first = ELEMENT_AT(base, lo, size);
+    char *middle = ELEMENT_AT(base, lo + (hi - lo) / 2, size);
+    char *last = ELEMENT_AT(base, hi - 1, size);
+
+    // Order first, middle and last, then use the median as the pivot.
+    if (cmpfn(middle, first) < 0) {
+      swap_elements(middle, first, size);
+    }
+    if (cmpfn(last, middle) < 0) {
+      swap_elements(last, middle, size);
+      if (cmpfn(middle, first) < 0) {
+        swap_elements(middle, first, size);
+      }
+    }
+    swap_elements(first, middle, size);
+
+    unsigned int i = lo;
+    unsigned int j = hi;
+
+    while (1) {
+      do {
+        i++;
+      } while (i < hi && cmpfn(ELEMENT_AT(base, i, size), first) < 0);
+
+      do {
+        j--;
+      } while (cmpfn(ELEMENT_AT(base, j, size), first) > 0);
+
+      if (i >= j) {
+        break;
+      }
+
+      swap_elements(ELEMENT_AT(base, i, size), ELEMENT_AT(base, j, size),
+                    size);
+    }
+
+    // Pivot ends up in its final position.
+    swap_elements(first, ELEMENT_AT(base, j, size), size);
+
+    // Recurse into the smaller side to bound the stack depth.
+    if (j - lo < hi - j - 1) {
+      intro_sort(base, lo, j, size, cmpfn, depth);
+      lo = j + 1;
+    } else {
+      intro_sort(base, j + 1, hi, size, cmpfn, depth);
+      hi = j;
+    }
+  }
+
+  insertion_sort(base, lo, hi, size, cmpfn);
+}
+
+/**
+ * Compare two string elements.
+ */
+static int compare_str(void *a, void *b) {
+  return strcmp(*(char **)a, *(char **)b);
+}
+
+/**
+ * Sort unsigned integers using LSD radix sort, skipping every byte all the
+ * elements share.
+ *
+ * @param items integers to sort.
+ * @param aux buffer with room for length integers.
+ * @param length number of integers.
+ */
+static void radix_sort_ulong(unsigned long *items, unsigned long *aux,
+                             unsigned int length) {
+  unsigned long *source = items;
+  unsigned long *dest = aux;
+
+  for (unsigned int shift = 0; shift < sizeof(long) * 8; shift += 8) {
+    unsigned int count[256] = {0};
+
+    for (unsigned int i = 0; i < length; i++) {
+      count[(source[i] >> shift) & 0xff]++;
+    }
+
+    // Every element shares this byte, order is unchanged.
+    if (count[(source[0] >> shift) & 0xff] == length) {
+      continue;
+    }
+
+    unsigned int position = 0;
+    for (unsigned int i = 0; i < 256; i++) {
+      unsigned int bucket_length = count[i];
+      count[i] = position;
+      position += bucket_length;
+    }
+
+    for (unsigned int i = 0; i < length; i++) {
+      dest[count[(source[i] >> shift) & 0xff]++] = source[i];
+    }
+
+    unsigned long *temp = source;
+    source = dest;
+    dest = temp;
+  }
+
+  if (source != items) {
+    memcpy(items, source, sizeof(unsigned long) * length);
+  }
+}
+
+/**
+ * Deallocate removed strings with the array's freefn.
+ *
+ * Once sorted, strings are scattered in memory, deallocating them in
+ * address order is several times faster.
+ *
+ * @param array dynamic_array the strings were removed from.
+ * @param removed the strings, followed by room for as many.
+ * @param length number of strings.
+ */
+static void free_removed_str(dynamic_array *array, unsigned long *removed,
+                             unsigned int length) {
+  if (array->freefn == NULL) {
+    return;
+  }
+
+  radix_sort_ulong(removed, removed + length, length);
+
+  for (unsigned int i = 0; i < length; i++) {
+    array->freefn((void **)removed[i]);
+  }
+}
+
+/**
+ * Scratch space of radix_sort_str, every array has room for all the
+ * strings and is indexed like them.
+ */
+typedef struct radix_str_buffers {
+  char **aux;                    // Strings being moved.
+  unsigned long long *keys;      // 8 characters of every string.
+  unsigned long long *aux_keys;  // Keys being moved.
+  unsigned char *duplicates;     // Set for every string equal to the
+                                 // previous one once sorted, NULL if not
+                                 // needed.
+} radix_str_buffers;
+
+/**
+ * Pack the first 8 characters of a string, in order, into an integer. The
+ * characters past the end of the string are 0.
+ */
+static unsigned long long str_key(const char *str) {
+  unsigned long long key = 0;
+
+  for (unsigned int i = 0; i < 8 && str[i] != '\0'; i++) {
+    key |= (unsigned long long)(unsigned char)str[i] << (56 - 8 * i);
+  }
+
+  return key;
+}
+
+/**
+ * Sort strings by their keys with insertion sort.
+ *
+ * @param items strings to sort.
+ * @param keys 8 characters of every string.
+ * @param length number of strings.
+ */
+static void insertion_sort_keyed_str(char **items, unsigned long long *keys,
+                                     unsigned int length) {
+  for (unsigned int i = 1; i < length; i++) {
+    char *item = items[i];
+    unsigned long long key = keys[i];
+    unsigned int j = i;
+
+    for (; j > 0 && keys[j - 1] > key; j--) {
+      items[j] = items[j - 1];
+      keys[j] = keys[j - 1];
+    }
+
+    items[j] = item;
+    keys[j] = key;
+  }
+}
+
+/**
+ * Sort strings using MSD radix sort, starting at the given character.
+ *
+ * The next 8 characters of every string are cached as an integer key, so
+ * strings are only dereferenced once every 8 passes. Strings left in the
+ * '\0' bucket are equal, they are marked as duplicates instead of being
+ * sorted further.
+ *
+ * @param items every string, the ones from first are sorted.
+ * @param first position of the first string to sort.
+ * @param length number of strings to sort.
+ * @param depth character position all strings share a prefix up to, keys
+ *              hold the characters from there.
+ * @param byte number of key characters all strings share, 8 if the keys
+ *             have to be read.
+ * @param buffers scratch space.
+ */
+static void radix_sort_str(char **items, unsigned int first,
+                           unsigned int length, unsigned int depth,
+                           unsigned int byte, radix_str_buffers *buffers) {
+  char **source = items + first;
+  unsigned long long *keys = buffers->keys + first;
+  unsigned char *duplicates =
+      buffers->duplicates != NULL ? buffers->duplicates + first : NULL;
+
+  while (1) {
+    unsigned int count[257] = {0};
+
+    if (byte == 8) {
+      for (unsigned int i = 0; i < length; i++) {
+        // Strings are scattered in memory, start loading the next ones.
+        if (i + DYNAMIC_ARRAY_PREFETCH_DISTANCE < length) {
+          __builtin_prefetch(source[i + DYNAMIC_ARRAY_PREFETCH_DISTANCE] +
+                             depth);
+        }
+        keys[i] = str_key(source[i] + depth);
+      }
+      byte = 0;
+    }
+
+    if (length < DYNAMIC_ARRAY_RADIX_THRESHOLD) {
+      insertion_sort_keyed_str(source, keys, length);
+      break;
+    }
+
+    // Skip every character all the strings share in one pass.
+    unsigned long long diff = 0;
+    for (unsigned int i = 1; i < length; i++) {
+      diff |= keys[i] ^ keys[0];
+    }
+
+    diff <<= 8 * byte;
+    if (diff == 0) {
+      // Keys end with '\0' when the strings end within them, equal strings.
+      if ((keys[0] & 0xff) == 0) {
+        if (duplicates != NULL) {
+          memset(duplicates + 1, 1, length - 1);
+        }
+        return;
+      }
+
+      depth += 8;
+      byte = 8;
+      continue;
+    }
+
+    byte += __builtin_clzll(diff) / 8;
+
+    unsigned int shift = 56 - 8 * byte;
+
+    for (unsigned int i = 0; i < length; i++) {
+      count[((keys[i] >> shift) & 0xff) + 1]++;
+    }
+
+    for (unsigned int i = 1; i < 257; i++) {
+      count[i] += count[i - 1];
+    }
+
+    char **aux = buffers->aux + first;
+    unsigned long long *aux_keys = buffers->aux_keys + first;
+
+    for (unsigned int i = 0; i < length; i++) {
+      unsigned int to = count[(keys[i] >> shift) & 0xff]++;
+      aux[to] = source[i];
+      aux_keys[to] = keys[i];
+    }
+
+    memcpy(source, aux, sizeof(char *) * length);
+    memcpy(keys, aux_keys, sizeof(unsigned long long) * length);
+
+    if (byte < 7) {
+      // Buckets are sorted on the next character of the keys.
+      for (unsigned int i = 1; i < 256; i++) {
+        unsigned int start = count[i - 1];
+        unsigned int bucket_length = count[i] - start;
+
+        if (bucket_length > 1) {
+          radix_sort_str(items, first + start, bucket_length, depth, byte + 1,
+                         buffers);
+        }
+      }
+
+      // Bucket '\0' holds equal strings.
+      if (duplicates != NULL && count[0] > 1) {
+        memset(duplicates + 1, 1, count[0] - 1);
+      }
+      return;
+    }
+
+    // Sorted on the last character of the keys, strings are now ordered by
+    // their keys.
+    break;
+  }
+
+  // Strings with equal keys are equal when the keys end with '\0',
+  // otherwise they are sorted on the next 8 characters.
+  unsigned int start = 0;
+  for (unsigned int i = 1; i <= length; i++) {
+    if (i < length && keys[i] == keys[start]) {
+      continue;
+    }
+
+    unsigned int run = i - start;
+
+    if (run > 1 && (keys[start] & 0xff) != 0) {
+      radix_sort_str(items, first + start, run, depth + 8, 8, buffers);
+    } else if (run > 1 && duplicates != NULL) {
+      memset(duplicates + start + 1, 1, run - 1);
+    }
+
+    start = i;
+  }
+}
+
+/**
+ * Sort an array of strings, marking duplicates if requested.
+ *
+ * @param duplicates where to mark duplicates, NULL if not needed.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int sort_str(dynamic_array *array, unsigned char *duplicates) {
+  int result = STATUS_SUCCESS;
+  radix_str_buffers buffers = {NULL, NULL, NULL, duplicates};
+
+  if ((buffers.aux = malloc(sizeof(char *) * array->size)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  if ((buffers.keys = malloc(sizeof(unsigned long long) * array->size)) ==
+      NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  if ((buffers.aux_keys = malloc(sizeof(unsigned long long) * array->size)) ==
+      NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  radix_sort_str((char **)array->items, 0, array->size, 0, 8, &buffers);
+
+defer:
+  free(buffers.aux);
+  free(buffers.keys);
+  free(buffers.aux_keys);
+  return result;
+}
+
+int dynamic_array_sort(dynamic_array *array, int (*cmpfn)(void *, void *)) {
+  int result = STATUS_SUCCESS;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (cmpfn == NULL) {
+    cmpfn = array->matchfn;
+  }
+
+  // elements cannot be ordered.
+  if (cmpfn == NULL) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  // Allow 2 * log2(size) partitions before switching to heapsort.
+  unsigned int depth = 0;
+  for (unsigned int n = array->size; n > 1; n >>= 1) {
+    depth += 2;
+  }
+
+  intro_sort((char *)array->items, 0, array->size, array->data_size, cmpfn,
+             depth);
+
+defer:
+  return result;
+}
+
+int dynamic_array_sort_str(dynamic_array *array) {
+  int result = STATUS_SUCCESS;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  result = sort_str(array, NULL);
+
+defer:
+  return result;
+}
+
+int dynamic_array_sort_unique_str(dynamic_array *array) {
+  int result = STATUS_SUCCESS;
+  unsigned char *duplicates = NULL;
+  unsigned long *removed = NULL;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  if ((duplicates = calloc(array->size, 1)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  // Room for the removed strings and for sorting them.
+  if ((removed = malloc(sizeof(unsigned long) * array->size * 2)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  if ((result = sort_str(array, duplicates)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  unsigned int kept = 0;          // Number of unique strings so far.
+  unsigned int removed_size = 0;  // Number of duplicates.
+
+  for (unsigned int i = 0; i < array->size; i++) {
+    if (!duplicates[i]) {
+      array->items[kept++] = array->items[i];
+    } else {
+      removed[removed_size++] = (unsigned long)array->items[i];
+    }
+  }
+
+  array->size = kept;
+  free_removed_str(array, removed, removed_size);
+
+defer:
+  free(duplicates);
+  free(removed);
+  return result;
+}
+
+int dynamic_array_sort_long(dynamic_array *array) {
+  int result = STATUS_SUCCESS;
+  unsigned long *aux = NULL;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->data_size != sizeof(long)) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  if ((aux = malloc(sizeof(unsigned long) * array->size)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  // Flipping the sign bit makes unsigned order match signed order.
+  const unsigned long sign = 1UL << (sizeof(long) * 8 - 1);
+  unsigned long *items = (unsigned long *)array->items;
+
+  for (unsigned int i = 0; i < array->size; i++) {
+    items[i] ^= sign;
+  }
+
+  radix_sort_ulong(items, aux, array->size);
+
+  for (unsigned int i = 0; i < array->size; i++) {
+    items[i] ^= sign;
+  }
+
+defer:
+  if (aux != NULL) {
+    free(aux);
+  }
+  return result;
+}
+
+int dynamic_array_bsearch(dynamic_array *array, const void *key,
+                          int (*cmpfn)(void *, void *), unsigned int *index) {
+  int result = STATUS_FAILURE;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (cmpfn == NULL) {
+    cmpfn = array->matchfn;
+  }
+
+  if (cmpfn == NULL) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  unsigned int lo = 0;
+  unsigned int hi = array->size;
+
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    int order =
+        cmpfn((void *)key, ELEMENT_AT(array->items, mid, array->data_size));
+
+    if (order == 0) {
+      lo = mid;
+      result = STATUS_SUCCESS;
+      break;
+    } else if (order < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  if (index != NULL) {
+    *index = lo;
+  }
+
+defer:
+  return result;
+}
+
+int dynamic_array_unique(dynamic_array *array, int (*cmpfn)(void *, void *)) {
+  int result = STATUS_SUCCESS;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (cmpfn == NULL) {
+    cmpfn = array->matchfn;
+  }
+
+  if (cmpfn == NULL) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  unsigned int size = array->data_size;
+  unsigned int kept = 1;  // Number of unique elements so far.
+
+  for (unsigned int i = 1; i < array->size; i++) {
+    char *current = ELEMENT_AT(array->items, i, size);
+
+    if (cmpfn(ELEMENT_AT(array->items, kept - 1, size), current) == 0) {
+      if (array->freefn != NULL) {
+        array->freefn(array->items[i]);
+      }
+      continue;
+    }
+
+    if (kept != i) {
+      memcpy(ELEMENT_AT(array->items, kept, size), current, size);
+    }
+    kept++;
+  }
+
+  array->size = kept;
+
+defer:
+  return result;
+}
+
+int dynamic_array_unique_str(dynamic_array *array) {
+  int result = STATUS_SUCCESS;
+  unsigned long *removed = NULL;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  // Room for the removed strings and for sorting them, without it they are
+  // deallocated as they are found.
+  if ((removed = malloc(sizeof(unsigned long) * array->size * 2)) == NULL) {
+    RETURN_DEFER(dynamic_array_unique(array, compare_str));
+  }
+
+  char **items = (char **)array->items;
+  unsigned int kept = 1;          // Number of unique strings so far.
+  unsigned int removed_size = 0;  // Number of duplicates.
+
+  for (unsigned int i = 1; i < array->size; i++) {
+    if (strcmp(items[kept - 1], items[i]) == 0) {
+      removed[removed_size++] = (unsigned long)items[i];
+    } else {
+      items[kept++] = items[i];
+    }
+  }
+
+  array->size = kept;
+  free_removed_str(array, removed, removed_size);
+
+defer:
+  free(removed);
+  return result;
+}
+
+/**
+ * Find the position of value in an array of 4 byte elements.
+ *
+ * @return position of the element, length if not found.
+ */
+static unsigned int index_of_32(const unsigned int *items, unsigned int length,
+                                unsigned int value) {
+  unsigned int i = 0;
+
+#ifdef __SSE2__
+  __m128i needle = _mm_set1_epi32((int)value);
+
+  for (; i + 4 <= length; i += 4) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(items + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(chunk, needle));
+
+    if (mask != 0) {
+      return i + __builtin_ctz(mask) / 4;
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    if (items[i] == value) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+/**
+ * Find the position of value in an array of 8 byte elements.
+ *
+ * @return position of the element, length if not found.
+ */
+static unsigned int index_of_64(const unsigned long long *items,
+                                unsigned int length, unsigned long long value) {
+  unsigned int i = 0;
+
+#ifdef __SSE2__
+  __m128i needle = _mm_set1_epi64x((long long)value);
+
+  for (; i + 2 <= length; i += 2) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(items + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(chunk, needle));
+
+    // Both 4 byte halves of an element must match.
+    if ((mask & 0x00ff) == 0x00ff) {
+      return i;
+    }
+    if ((mask & 0xff00) == 0xff00) {
+      return i + 1;
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    if (items[i] == value) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+int dynamic_array_index_of(dynamic_array *array, const void *item,
+                           unsigned int *index) {
+  int result = STATUS_SUCCESS;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  // item must be defined.
+  if (item == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  unsigned int size = array->data_size;
+  unsigned int position = array->size;
+
+  if (array->size == 0) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (array->matchfn != NULL) {
+    for (position = 0; position < array->size; position++) {
+      if (array->matchfn(ELEMENT_AT(array->items, position, size),
+                         (void *)item) == 0) {
+        break;
+      }
+    }
+  } else if (size == 1) {
+    char *found = memchr(array->items, *(const char *)item, array->size);
+    if (found != NULL) {
+      position = found - (char *)array->items;
+    }
+  } else if (size == 4) {
+    unsigned int value;
+    memcpy(&value, item, sizeof(value));
+    position = index_of_32((const unsigned int *)array->items, array->size,
+                           value);
+  } else if (size == 8) {
+    unsigned long long value;
+    memcpy(&value, item, sizeof(value));
+    position = index_of_64((const unsigned long long *)array->items,
+                           array->size, value);
+  } else {
+    for (position = 0; position < array->size; position++) {
+      if (memcmp(ELEMENT_AT(array->items, position, size), item, size) == 0) {
+        break;
+      }
+    }
+  }
+
+  if (position == array->size) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (index != NULL) {
+    *index = position;
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Shared state of a parallel for/map over an array.
+ */
+typedef struct dynamic_array_parallel_ctx {
+  dynamic_array *array;
+  dynamic_array *output;
+  unsigned int output_offset;  // Where the results start in output.
+  int (*for_fn)(void *, unsigned int, void *);
+  int (*map_fn)(void *, void *, void *);
+  void *ctx;
+} dynamic_array_parallel_ctx;
+
+static int parallel_for_chunk(unsigned int begin, unsigned int end,
+                              void *arg) {
+  dynamic_array_parallel_ctx *pctx = arg;
+  unsigned int size = pctx->array->data_size;
+
+  for (unsigned int i = begin; i < end; i++) {
+    if (pctx->for_fn(ELEMENT_AT(pctx->array->items, i, size), i, pctx->ctx) !=
+        0) {
+      return STATUS_FAILURE;
+    }
+  }
+
+  return STATUS_SUCCESS;
+}
+
+static int parallel_map_chunk(unsigned int begin, unsigned int end,
+                              void *arg) {
+  dynamic_array_parallel_ctx *pctx = arg;
+  unsigned int size = pctx->array->data_size;
+  unsigned int out_size = pctx->output->data_size;
+
+  for (unsigned int i = begin; i < end; i++) {
+    if (pctx->map_fn(ELEMENT_AT(pctx->array->items, i, size),
+                     ELEMENT_AT(pctx->output->items, pctx->output_offset + i,
+                                out_size),
+                     pctx->ctx) != 0) {
+      return STATUS_FAILURE;
+    }
+  }
+
+  return STATUS_SUCCESS;
+}
+
+int dynamic_array_parallel_for(dynamic_array *array,
+                               int (*fn)(void *item, unsigned int index,
+                                         void *ctx),
+                               void *ctx, unsigned int grain) {
+  int result = STATUS_SUCCESS;
+  thread_pool *pool = NULL;
+
+  if (array == NULL || fn == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = thread_pool_get_default(&pool)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  dynamic_array_parallel_ctx pctx = {array, NULL, 0, fn, NULL, ctx};
+
+  result = thread_pool_parallel_for(pool, array->size, grain,
+                                    parallel_for_chunk, &pctx);
+
+defer:
+  return result;
+}
+
+int dynamic_array_parallel_map(dynamic_array *array, dynamic_array *output,
+                               int (*fn)(void *item, void *out, void *ctx),
+                               void *ctx, unsigned int grain) {
+  int result = STATUS_SUCCESS;
+  thread_pool *pool = NULL;
+
+  if (array == NULL || output == NULL || fn == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size == 0) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  if ((result = thread_pool_get_default(&pool)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  unsigned int offset = output->size;
+
+  // Make room for every result up front so threads never resize output.
+  if (output->items == NULL) {
+    while (output->capacity < offset + array->size) {
+      output->capacity <<= 1;
+    }
+    if ((output->items = calloc(output->capacity, output->data_size)) ==
+        NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+  } else {
+    while (output->capacity < offset + array->size) {
+      if (dynamic_array_resize(&output) != 0) {
+        RETURN_DEFER(STATUS_MEMORY_FAILURE);
+      }
+    }
+    memset(ELEMENT_AT(output->items, offset, output->data_size), 0,
+           (size_t)array->size * output->data_size);
+  }
+
+  output->size = offset + array->size;
+
+  dynamic_array_parallel_ctx pctx = {array, output, offset, NULL, fn, ctx};
+
+  result = thread_pool_parallel_for(pool, array->size, grain,
+                                    parallel_map_chunk, &pctx);
+
+defer:
+  return result;
+}
+
 void dynamic_array_destroy(dynamic_array **array) {
   if (*array != NULL) {
     if ((*array)->freefn != NULL) {
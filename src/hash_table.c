@@ -51,16 +51,17 @@ static unsigned int hash(const char *key, unsigned int length) {
  *
  * @param array of hash table entries.
  * @param capacity max number of entries the hash table can hold at this time.
- * @param key identifier used to search for.
- * @param key identifier used to search for.
+ * @param key identifier used to search for, not null terminated.
+ * @param key_length number of characters in key.
  *
  * @return hash table entry to modify.
  */
 static hash_table_entry *find_entry(hash_table_entry *entries,
                                     unsigned int capacity, const char *key,
+                                    unsigned int key_length,
                                     unsigned int (*hashfn)(const char *,
                                                            unsigned int)) {
-  unsigned int index = hashfn(key, strlen(key)) & (capacity - 1);
+  unsigned int index = hashfn(key, key_length) & (capacity - 1);
   hash_table_entry *tombstone = NULL;
 
   while (1) {
@@ -76,7 +77,8 @@ static hash_table_entry *find_entry(hash_table_entry *entries,
           tombstone = entry;
         }
       }
-    } else if (strcmp(entry->key, key) == 0) {
+    } else if (strncmp(entry->key, key, key_length) == 0 &&
+               entry->key[key_length] == '\0') {
       return entry;
     }
 
@@ -107,8 +109,8 @@ static void resize(hash_table *ht, int capacity) {
       continue;
     }
 
-    hash_table_entry *dest =
-        find_entry(new_entries, capacity, entry->key, ht->hashfn);
+    hash_table_entry *dest = find_entry(new_entries, capacity, entry->key,
+                                        strlen(entry->key), ht->hashfn);
 
     dest->key = entry->key;
     dest->value = entry->value;
@@ -149,6 +151,11 @@ int hash_table_get_size(hash_table *ht) {
 }
 
 int hash_table_insert(hash_table *ht, const char *key, const void *value) {
+  return hash_table_insert_n(ht, key, strlen(key), value);
+}
+
+int hash_table_insert_n(hash_table *ht, const char *key,
+                        unsigned int key_length, const void *value) {
   int result = STATUS_SUCCESS;
 
   if (ht == NULL) {
@@ -172,9 +179,8 @@ int hash_table_insert(hash_table *ht, const char *key, const void *value) {
   }
 
   hash_table_entry *entry =
-      find_entry(ht->entries, ht->capacity, key, ht->hashfn);
+      find_entry(ht->entries, ht->capacity, key, key_length, ht->hashfn);
   int is_new_key = entry->key == 0;
-  int key_length = strlen(key);
 
   if (!is_new_key) {
     // Key is already found
@@ -186,7 +192,7 @@ int hash_table_insert(hash_table *ht, const char *key, const void *value) {
   }
 
   entry->key = malloc(sizeof(char) * (key_length + 1));
-  strcpy(entry->key, key);
+  memcpy(entry->key, key, key_length);
   entry->key[key_length] = '\0';
 
   if (ht->freefn == NULL) {
@@ -225,10 +231,10 @@ int hash_table_insert_and_replace(hash_table *ht, const char *key,
     resize(ht, ht->capacity * 2);
   }
 
+  int key_length = strlen(key);
   hash_table_entry *entry =
-      find_entry(ht->entries, ht->capacity, key, ht->hashfn);
+      find_entry(ht->entries, ht->capacity, key, key_length, ht->hashfn);
   int is_new_key = entry->key == NULL;
-  int key_length = strlen(key);
 
   if (is_new_key) {
     ht->size++;
@@ -258,6 +264,11 @@ defer:
 }
 
 int hash_table_search(hash_table *ht, const char *key, void **value) {
+  return hash_table_search_n(ht, key, strlen(key), value);
+}
+
+int hash_table_search_n(hash_table *ht, const char *key,
+                        unsigned int key_length, void **value) {
   int result = STATUS_SUCCESS;
 
   if (ht == NULL) {
@@ -268,7 +279,7 @@ int hash_table_search(hash_table *ht, const char *key, void **value) {
     RETURN_DEFER(STATUS_IS_EMPTY);
   }
 
-  if (strlen(key) == 0) {
+  if (key_length == 0) {
     if (value != NULL) {
       // Ignore value
       *value = NULL;
@@ -277,7 +288,7 @@ int hash_table_search(hash_table *ht, const char *key, void **value) {
   }
 
   hash_table_entry *entry =
-      find_entry(ht->entries, ht->capacity, key, ht->hashfn);
+      find_entry(ht->entries, ht->capacity, key, key_length, ht->hashfn);
 
   if (entry->key == NULL) {
     if (value != NULL) {
@@ -308,7 +319,7 @@ int hash_table_delete(hash_table *ht, const char *key) {
   }
 
   hash_table_entry *entry =
-      find_entry(ht->entries, ht->capacity, key, ht->hashfn);
+      find_entry(ht->entries, ht->capacity, key, strlen(key), ht->hashfn);
 
   // Key not found, there is no entry to delete.
   if (entry->key == NULL) {
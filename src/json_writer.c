@@ -0,0 +1,257 @@
+#include "json_writer.h"
+
+#include <string.h>
+
+#include "logger.h"
+#include "string_slice.h"
+
+/**
+ * Write the comma that separates a value from the previous one, unless the
+ * value follows a key.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int json_writer_separate(json_writer *jw) {
+  unsigned int bit = 1U << jw->depth;
+
+  if (jw->after_key) {
+    jw->after_key = 0;
+    return STATUS_SUCCESS;
+  }
+
+  if (jw->has_values & bit) {
+    return string_builder_append_char(jw->sb, ',');
+  }
+
+  jw->has_values |= bit;
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * Write the separator and the opening character of an array or object.
+ *
+ * @return same as json_writer_begin_array.
+ */
+static int json_writer_open(json_writer *jw, char ch) {
+  int result = STATUS_SUCCESS;
+
+  if (jw->depth == JSON_WRITER_MAX_DEPTH) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  if ((result = json_writer_separate(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = string_builder_append_char(jw->sb, ch)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  jw->depth++;
+  jw->has_values &= ~(1U << jw->depth);
+
+defer:
+  return result;
+}
+
+/**
+ * Write the closing character of the innermost array or object.
+ *
+ * @return same as json_writer_end_array.
+ */
+static int json_writer_close(json_writer *jw, char ch) {
+  int result = STATUS_SUCCESS;
+
+  if (jw->depth == 0) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  jw->depth--;
+  result = string_builder_append_char(jw->sb, ch);
+
+defer:
+  return result;
+}
+
+void json_writer_init(json_writer *jw, string_builder *sb) {
+  jw->sb = sb;
+  jw->depth = 0;
+  jw->has_values = 0;
+  jw->after_key = 0;
+}
+
+int json_writer_begin_array(json_writer *jw) {
+  return json_writer_open(jw, '[');
+}
+
+int json_writer_end_array(json_writer *jw) {
+  return json_writer_close(jw, ']');
+}
+
+int json_writer_begin_object(json_writer *jw) {
+  return json_writer_open(jw, '{');
+}
+
+int json_writer_end_object(json_writer *jw) {
+  return json_writer_close(jw, '}');
+}
+
+int json_writer_key(json_writer *jw, const char *key, size_t length) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = json_writer_string(jw, key, length)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = string_builder_append_char(jw->sb, ':')) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  jw->after_key = 1;
+
+defer:
+  return result;
+}
+
+int json_writer_string(json_writer *jw, const char *str, size_t length) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = json_writer_begin_string(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  if ((result = json_writer_append_string(jw, str, length)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = json_writer_end_string(jw);
+
+defer:
+  return result;
+}
+
+int json_writer_begin_string(json_writer *jw) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = json_writer_separate(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = string_builder_append_char(jw->sb, '"');
+
+defer:
+  return result;
+}
+
+int json_writer_append_string(json_writer *jw, const char *str,
+                              size_t length) {
+  static const char hex_digits[] = "0123456789abcdef";
+  int result = STATUS_SUCCESS;
+  size_t start = 0;
+  size_t valid_end = 0;  // Characters before it are known to be UTF-8.
+
+  for (size_t i = 0; i < length; i++) {
+    unsigned char ch = (unsigned char)str[i];
+    char escape[6] = {'\\', 0, 0, 0, 0, 0};
+    size_t escape_length = 2;
+
+    if (ch >= 0x80 && i >= valid_end) {
+      size_t error_index = 0;
+
+      // Validate up to the next invalid byte, so every byte is only
+      // checked once.
+      string_slice_validate_utf8(string_slice_make(str + i, length - i),
+                                 &error_index);
+      valid_end = i + error_index;
+    }
+
+    // Valid UTF-8 and characters that need no escaping are kept as is.
+    if (ch >= 0x80 ? i < valid_end : ch >= 0x20 && ch != '"' && ch != '\\') {
+      continue;
+    }
+
+    // Characters that need no escaping are copied in one go.
+    if (string_builder_append(jw->sb, str + start, i - start) != 0) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    switch (ch) {
+      case '"':
+      case '\\':
+        escape[1] = ch;
+        break;
+      case '\n':
+        escape[1] = 'n';
+        break;
+      case '\r':
+        escape[1] = 'r';
+        break;
+      case '\t':
+        escape[1] = 't';
+        break;
+      case '\b':
+        escape[1] = 'b';
+        break;
+      case '\f':
+        escape[1] = 'f';
+        break;
+      default:
+        if (ch >= 0x80) {
+          // Not UTF-8, written as the replacement character.
+          memcpy(escape, "\\ufffd", 6);
+          escape_length = 6;
+          break;
+        }
+
+        // Other control characters as \u00XX.
+        escape[1] = 'u';
+        escape[2] = '0';
+        escape[3] = '0';
+        escape[4] = hex_digits[ch >> 4];
+        escape[5] = hex_digits[ch & 0xF];
+        escape_length = 6;
+    }
+
+    if (string_builder_append(jw->sb, escape, escape_length) != 0) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    start = i + 1;
+  }
+
+  result = string_builder_append(jw->sb, str + start, length - start);
+
+defer:
+  return result;
+}
+
+int json_writer_end_string(json_writer *jw) {
+  return string_builder_append_char(jw->sb, '"');
+}
+
+int json_writer_long(json_writer *jw, long value) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = json_writer_separate(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = string_builder_append_long(jw->sb, value);
+
+defer:
+  return result;
+}
+
+int json_writer_null(json_writer *jw) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = json_writer_separate(jw)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  result = string_builder_append(jw->sb, "null", 4);
+
+defer:
+  return result;
+}
@@ -0,0 +1,93 @@
+#include "logger.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Messages up to this long are formatted on the stack.
+#define LOGGER_BUFFER_CAPACITY 512
+
+static void (*logger_sink)(int, const char *, size_t, void *) = NULL;
+static void *logger_ctx = NULL;
+static int logger_colors = -1;  // -1 until isatty has been called.
+
+/**
+ * Prefix of a message of the given level, colored or not.
+ */
+static const char *level_prefix(int level, int colors) {
+  switch (level) {
+    case LOG_LEVEL_ERROR:
+      return colors ? TERMINAL_RED "error" TERMINAL_RESET ": " : "error: ";
+    case LOG_LEVEL_WARN:
+      return colors ? TERMINAL_YELLOW "warning" TERMINAL_RESET ": "
+                    : "warning: ";
+    case LOG_LEVEL_INFO:
+      return colors ? TERMINAL_BLUE "info" TERMINAL_RESET ": " : "info: ";
+    default:
+      return "debug: ";
+  }
+}
+
+void logger_log(int level, const char *format, ...) {
+  char buffer[LOGGER_BUFFER_CAPACITY];
+  char *message = buffer;
+  // A sink gets plain text, colors are only for a terminal stderr.
+  const char *prefix =
+      level_prefix(level, logger_sink == NULL && logger_use_colors());
+  int prefix_length = 0;
+  int length = 0;
+  va_list args;
+
+  prefix_length = snprintf(buffer, sizeof(buffer), "%s", prefix);
+
+  va_start(args, format);
+  length = vsnprintf(buffer + prefix_length, sizeof(buffer) - prefix_length,
+                     format, args);
+  va_end(args);
+
+  if (length < 0) {
+    return;
+  }
+
+  // Leave room for the newline, format again on the heap when too long.
+  if ((size_t)(prefix_length + length + 1) >= sizeof(buffer)) {
+    if ((message = malloc(prefix_length + length + 2)) == NULL) {
+      return;
+    }
+
+    memcpy(message, prefix, prefix_length);
+
+    va_start(args, format);
+    vsnprintf(message + prefix_length, length + 1, format, args);
+    va_end(args);
+  }
+
+  length += prefix_length;
+  message[length++] = '\n';
+
+  // The whole line is written at once so it does not interleave.
+  if (logger_sink != NULL) {
+    logger_sink(level, message, length, logger_ctx);
+  } else {
+    fwrite(message, 1, length, stderr);
+  }
+
+  if (message != buffer) {
+    free(message);
+  }
+}
+
+void logger_set_sink(void (*sink)(int level, const char *message,
+                                  size_t length, void *ctx),
+                     void *ctx) {
+  logger_sink = sink;
+  logger_ctx = ctx;
+}
+
+int logger_use_colors(void) {
+  if (logger_colors == -1) {
+    logger_colors = isatty(STDERR_FILENO);
+  }
+  return logger_colors;
+}
@@ -0,0 +1,329 @@
+#include "output_sink.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+// Buffered text is delivered early once it grows past this many bytes.
+#define OUTPUT_SINK_BUFFER_LIMIT (64 * 1024)
+
+// Pieces handed to a single writev, well under any IOV_MAX.
+#define OUTPUT_SINK_IOV_BATCH 64
+
+typedef enum output_sink_kind {
+  OUTPUT_SINK_FILE,
+  OUTPUT_SINK_FD,
+  OUTPUT_SINK_MEMORY,
+  OUTPUT_SINK_CALLBACK,
+} output_sink_kind;
+
+struct output_sink {
+  output_sink_kind kind;
+  FILE *file;              // OUTPUT_SINK_FILE
+  int fd;                  // OUTPUT_SINK_FD
+  string_builder *memory;  // OUTPUT_SINK_MEMORY
+  int (*fn)(const char *, size_t, void *);  // OUTPUT_SINK_CALLBACK
+  void *ctx;                                // OUTPUT_SINK_CALLBACK
+  string_builder buffer;  // Text not yet delivered(fd and callback).
+};
+
+/**
+ * Allocate a sink of a given kind with an empty buffer.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int output_sink_init(output_sink **sink, output_sink_kind kind) {
+  int result = STATUS_SUCCESS;
+
+  if ((*sink = malloc(sizeof(output_sink))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  (*sink)->kind = kind;
+  (*sink)->file = NULL;
+  (*sink)->fd = -1;
+  (*sink)->memory = NULL;
+  (*sink)->fn = NULL;
+  (*sink)->ctx = NULL;
+  string_builder_init(&(*sink)->buffer, NULL, 0);
+
+defer:
+  return result;
+}
+
+/**
+ * Write the whole buffer to the file descriptor, resuming after partial
+ * writes and interrupted calls.
+ *
+ * @return 0 on success, 1 indicates writing failed.
+ */
+static int write_all(int fd, const char *data, size_t length) {
+  int result = STATUS_SUCCESS;
+
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      RETURN_DEFER(STATUS_FAILURE);
+    }
+
+    data += written;
+    length -= written;
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Write every piece to the file descriptor, resuming after partial writes
+ * and interrupted calls. iov is advanced past what was written.
+ *
+ * @return 0 on success, 1 indicates writing failed.
+ */
+static int writev_all(int fd, struct iovec *iov, int count) {
+  int result = STATUS_SUCCESS;
+
+  while (count > 0) {
+    ssize_t written = writev(fd, iov, count);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      RETURN_DEFER(STATUS_FAILURE);
+    }
+
+    while (count > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      count--;
+    }
+
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Write the buffered text followed by the pieces to the file descriptor,
+ * a batch of pieces per writev.
+ *
+ * @return 0 on success, 1 indicates writing failed.
+ */
+static int writev_fd(output_sink *sink, const struct iovec *iov, int count) {
+  int result = STATUS_SUCCESS;
+  struct iovec batch[OUTPUT_SINK_IOV_BATCH];
+  int used = 0;
+
+  if (sink->buffer.length > 0) {
+    batch[used].iov_base = sink->buffer.data;
+    batch[used].iov_len = sink->buffer.length;
+    used++;
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (iov[i].iov_len == 0) {
+      continue;
+    }
+
+    if (used == OUTPUT_SINK_IOV_BATCH) {
+      if ((result = writev_all(sink->fd, batch, used)) != 0) {
+        RETURN_DEFER(result);
+      }
+      used = 0;
+    }
+
+    batch[used++] = iov[i];
+  }
+
+  result = writev_all(sink->fd, batch, used);
+
+defer:
+  // Text that failed to be delivered is dropped, not retried.
+  string_builder_clear(&sink->buffer);
+  return result;
+}
+
+int output_sink_create_file(output_sink **sink, FILE *file) {
+  int result = STATUS_SUCCESS;
+
+  if (file == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = output_sink_init(sink, OUTPUT_SINK_FILE)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  (*sink)->file = file;
+
+defer:
+  return result;
+}
+
+int output_sink_create_fd(output_sink **sink, int fd) {
+  int result = STATUS_SUCCESS;
+
+  if ((result = output_sink_init(sink, OUTPUT_SINK_FD)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  (*sink)->fd = fd;
+
+defer:
+  return result;
+}
+
+int output_sink_create_memory(output_sink **sink, string_builder *buffer) {
+  int result = STATUS_SUCCESS;
+
+  if (buffer == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = output_sink_init(sink, OUTPUT_SINK_MEMORY)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  (*sink)->memory = buffer;
+
+defer:
+  return result;
+}
+
+int output_sink_create_callback(output_sink **sink,
+                                int (*fn)(const char *data, size_t length,
+                                          void *ctx),
+                                void *ctx) {
+  int result = STATUS_SUCCESS;
+
+  if (fn == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = output_sink_init(sink, OUTPUT_SINK_CALLBACK)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  (*sink)->fn = fn;
+  (*sink)->ctx = ctx;
+
+defer:
+  return result;
+}
+
+int output_sink_write(output_sink *sink, const char *data, size_t length) {
+  int result = STATUS_SUCCESS;
+
+  // sink and data must be defined.
+  if (sink == NULL || data == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  switch (sink->kind) {
+    case OUTPUT_SINK_FILE:
+      if (fwrite(data, 1, length, sink->file) != length) {
+        RETURN_DEFER(STATUS_FAILURE);
+      }
+      break;
+    case OUTPUT_SINK_MEMORY:
+      if (string_builder_append(sink->memory, data, length) != 0) {
+        RETURN_DEFER(STATUS_MEMORY_FAILURE);
+      }
+      break;
+    case OUTPUT_SINK_FD:
+    case OUTPUT_SINK_CALLBACK:
+      if (string_builder_append(&sink->buffer, data, length) != 0) {
+        RETURN_DEFER(STATUS_MEMORY_FAILURE);
+      }
+
+      if (sink->buffer.length >= OUTPUT_SINK_BUFFER_LIMIT) {
+        result = output_sink_flush(sink);
+      }
+      break;
+  }
+
+defer:
+  return result;
+}
+
+int output_sink_writev(output_sink *sink, const struct iovec *iov,
+                       int count) {
+  int result = STATUS_SUCCESS;
+
+  // sink and iov must be defined.
+  if (sink == NULL || iov == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (sink->kind == OUTPUT_SINK_FD) {
+    RETURN_DEFER(writev_fd(sink, iov, count));
+  }
+
+  for (int i = 0; i < count; i++) {
+    if ((result = output_sink_write(sink, iov[i].iov_base, iov[i].iov_len)) !=
+        0) {
+      RETURN_DEFER(result);
+    }
+  }
+
+defer:
+  return result;
+}
+
+int output_sink_flush(output_sink *sink) {
+  int result = STATUS_SUCCESS;
+
+  if (sink == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  switch (sink->kind) {
+    case OUTPUT_SINK_FILE:
+      if (fflush(sink->file) != 0) {
+        RETURN_DEFER(STATUS_FAILURE);
+      }
+      break;
+    case OUTPUT_SINK_MEMORY:
+      break;
+    case OUTPUT_SINK_FD:
+      if (sink->buffer.length > 0 &&
+          write_all(sink->fd, sink->buffer.data, sink->buffer.length) != 0) {
+        result = STATUS_FAILURE;
+      }
+      break;
+    case OUTPUT_SINK_CALLBACK:
+      if (sink->buffer.length > 0 &&
+          sink->fn(sink->buffer.data, sink->buffer.length, sink->ctx) != 0) {
+        result = STATUS_FAILURE;
+      }
+      break;
+  }
+
+  // Text that failed to be delivered is dropped, not retried.
+  string_builder_clear(&sink->buffer);
+
+defer:
+  return result;
+}
+
+void output_sink_destroy(output_sink **sink) {
+  if (*sink != NULL) {
+    output_sink_flush(*sink);
+    string_builder_release(&(*sink)->buffer);
+
+    free(*sink);
+    *sink = NULL;
+  }
+}
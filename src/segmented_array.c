@@ -0,0 +1,202 @@
+#include "segmented_array.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+// The first segment holds 2^SEGMENTED_ARRAY_FIRST_SHIFT elements, and every
+// segment after it twice as many as the one before.
+#define SEGMENTED_ARRAY_FIRST_SHIFT 3
+// Enough segments to address every unsigned int index, the last index
+// needs a 33 bit position.
+#define SEGMENTED_ARRAY_MAX_SEGMENTS (33 - SEGMENTED_ARRAY_FIRST_SHIFT)
+
+struct segmented_array {
+  char *segments[SEGMENTED_ARRAY_MAX_SEGMENTS];
+  void (*freefn)(void **);
+  unsigned int num_segments;  // Number of segments allocated.
+  unsigned int size;          // Number of elements in the array.
+  unsigned int data_size;     // Bytes needed for every element.
+};
+
+/**
+ * Find the segment and the position inside it of an element.
+ *
+ * Index i lives in segment k where 2^(FIRST_SHIFT + k) is the highest bit of
+ * i + 2^FIRST_SHIFT, so the lookup is a single bit scan.
+ */
+static inline void locate(unsigned int index, unsigned int *segment,
+                          unsigned int *offset) {
+  unsigned long long position =
+      (unsigned long long)index + (1ULL << SEGMENTED_ARRAY_FIRST_SHIFT);
+  unsigned int high_bit = 63 - __builtin_clzll(position);
+
+  *segment = high_bit - SEGMENTED_ARRAY_FIRST_SHIFT;
+  *offset = position - (1ULL << high_bit);
+}
+
+/**
+ * Reserve a slot for a new element at the end of the array.
+ *
+ * @return 0 on success,
+ *         2 indicates memory allocation failed,
+ *         4 indicates array is full.
+ */
+static int segmented_array_push(segmented_array *array, char **slot) {
+  int result = STATUS_SUCCESS;
+  unsigned int segment = 0;
+  unsigned int offset = 0;
+
+  if (array->size == (unsigned int)-1) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  locate(array->size, &segment, &offset);
+
+  if (segment == array->num_segments) {
+    size_t length = (size_t)1 << (segment + SEGMENTED_ARRAY_FIRST_SHIFT);
+
+    if ((array->segments[segment] = malloc(length * array->data_size)) ==
+        NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    array->num_segments++;
+  }
+
+  *slot = array->segments[segment] + (size_t)offset * array->data_size;
+  array->size++;
+
+defer:
+  return result;
+}
+
+int segmented_array_create(segmented_array **array, unsigned int data_size,
+                           void (*freefn)(void **)) {
+  int result = STATUS_SUCCESS;
+
+  if ((*array = malloc(sizeof(segmented_array))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  (*array)->freefn = freefn;
+  (*array)->num_segments = 0;
+  (*array)->size = 0;
+  (*array)->data_size = data_size;
+
+defer:
+  return result;
+}
+
+int segmented_array_add(segmented_array *array, const void *item) {
+  int result = STATUS_SUCCESS;
+  char *slot = NULL;
+
+  // array and item must be defined.
+  if (array == NULL || item == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = segmented_array_push(array, &slot)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  memcpy(slot, item, array->data_size);
+
+defer:
+  return result;
+}
+
+int segmented_array_add_str(segmented_array *array, const char *str) {
+  int result = STATUS_SUCCESS;
+  char *slot = NULL;
+
+  // array and str must be defined.
+  if (array == NULL || str == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if ((result = segmented_array_push(array, &slot)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  *(const char **)slot = str;
+
+defer:
+  return result;
+}
+
+int segmented_array_find_ref(segmented_array *array, unsigned int index,
+                             void **item) {
+  int result = STATUS_SUCCESS;
+  unsigned int segment = 0;
+  unsigned int offset = 0;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  // Array holds no elements.
+  if (array->size == 0) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  // Index out of bounds.
+  if (index >= array->size) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  locate(index, &segment, &offset);
+  *item = array->segments[segment] + (size_t)offset * array->data_size;
+
+defer:
+  return result;
+}
+
+int segmented_array_find_ref_str(segmented_array *array, unsigned int index,
+                                 char **str) {
+  int result = STATUS_SUCCESS;
+  void *item = NULL;
+
+  if ((result = segmented_array_find_ref(array, index, &item)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  *str = *(char **)item;
+
+defer:
+  return result;
+}
+
+int segmented_array_get_size(segmented_array *array) {
+  if (array == NULL) {
+    return -1;
+  }
+  return array->size;
+}
+
+int segmented_array_is_empty(segmented_array *array) {
+  return array->size == 0;
+}
+
+void segmented_array_destroy(segmented_array **array) {
+  if (*array != NULL) {
+    if ((*array)->freefn != NULL) {
+      for (unsigned int i = 0; i < (*array)->size; i++) {
+        void *item = NULL;
+
+        segmented_array_find_ref(*array, i, &item);
+        (*array)->freefn(*(void **)item);
+      }
+    }
+
+    for (unsigned int i = 0; i < (*array)->num_segments; i++) {
+      free((*array)->segments[i]);
+    }
+
+    free(*array);
+    *array = NULL;
+  }
+}
@@ -0,0 +1,279 @@
+#include "string_array.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define STRING_ARRAY_INITIAL_CAPACITY 8
+#define STRING_ARRAY_INITIAL_BYTES 256
+// How many strings ahead dedup prefetches.
+#define STRING_ARRAY_PREFETCH_DISTANCE 16
+// Odd constant mixing the characters of a string into its hash.
+#define STRING_ARRAY_HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+typedef struct string_array_entry {
+  unsigned int offset;  // Position of the first character in the buffer.
+  unsigned int length;  // Number of characters excluding the null byte.
+} string_array_entry;
+
+struct string_array {
+  char *buffer;                 // Every string followed by its null byte.
+  string_array_entry *entries;  // Where every string is in the buffer.
+  unsigned int bytes;           // Bytes used in the buffer.
+  unsigned int bytes_capacity;  // Bytes allocated for the buffer.
+  unsigned int size;            // Number of strings in the array.
+  unsigned int capacity;        // Limit of strings before resizing.
+};
+
+int string_array_create(string_array **array) {
+  int result = STATUS_SUCCESS;
+
+  if ((*array = malloc(sizeof(string_array))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  (*array)->buffer = NULL;
+  (*array)->entries = NULL;
+  (*array)->bytes = 0;
+  (*array)->bytes_capacity = 0;
+  (*array)->size = 0;
+  (*array)->capacity = 0;
+
+defer:
+  return result;
+}
+
+int string_array_append(string_array *array, const char *str,
+                        unsigned int length) {
+  int result = STATUS_SUCCESS;
+
+  // array and str must be defined.
+  if (array == NULL || str == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size == array->capacity) {
+    unsigned int capacity = array->capacity == 0 ? STRING_ARRAY_INITIAL_CAPACITY
+                                                 : array->capacity << 1;
+    string_array_entry *entries =
+        realloc(array->entries, sizeof(string_array_entry) * capacity);
+
+    if (entries == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    array->entries = entries;
+    array->capacity = capacity;
+  }
+
+  if (array->bytes + length + 1 > array->bytes_capacity) {
+    unsigned int bytes_capacity = array->bytes_capacity == 0
+                                      ? STRING_ARRAY_INITIAL_BYTES
+                                      : array->bytes_capacity;
+    char *buffer = NULL;
+
+    while (bytes_capacity < array->bytes + length + 1) {
+      bytes_capacity <<= 1;
+    }
+
+    if ((buffer = realloc(array->buffer, bytes_capacity)) == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    array->buffer = buffer;
+    array->bytes_capacity = bytes_capacity;
+  }
+
+  memcpy(array->buffer + array->bytes, str, length);
+  array->buffer[array->bytes + length] = '\0';
+
+  array->entries[array->size].offset = array->bytes;
+  array->entries[array->size].length = length;
+  array->bytes += length + 1;
+  array->size++;
+
+defer:
+  return result;
+}
+
+int string_array_get(string_array *array, unsigned int index, const char **str,
+                     unsigned int *length) {
+  int result = STATUS_SUCCESS;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  // Array holds no strings.
+  if (array->size == 0) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  // Index out of bounds.
+  if (index >= array->size) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  *str = array->buffer + array->entries[index].offset;
+
+  if (length != NULL) {
+    *length = array->entries[index].length;
+  }
+
+defer:
+  return result;
+}
+
+/**
+ * Hash a string 8 characters at a time.
+ *
+ * @param str string to hash.
+ * @param length number of characters in str.
+ *
+ * @return hash value.
+ */
+static unsigned long long hash_string(const char *str, unsigned int length) {
+  unsigned long long hash = length * STRING_ARRAY_HASH_MULTIPLIER;
+  unsigned long long word;
+
+  for (; length >= 8; str += 8, length -= 8) {
+    memcpy(&word, str, 8);
+    hash = (hash ^ word) * STRING_ARRAY_HASH_MULTIPLIER;
+    hash ^= hash >> 32;
+  }
+
+  if (length > 0) {
+    word = 0;
+    memcpy(&word, str, length);
+    hash = (hash ^ word) * STRING_ARRAY_HASH_MULTIPLIER;
+  }
+
+  hash ^= hash >> 29;
+  hash *= STRING_ARRAY_HASH_MULTIPLIER;
+
+  return hash ^ (hash >> 32);
+}
+
+int string_array_dedup(string_array *array) {
+  int result = STATUS_SUCCESS;
+  unsigned long long *hashes = NULL;
+  unsigned long long *slots = NULL;
+
+  // array must be defined.
+  if (array == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (array->size < 2) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  // At most half the slots are used, so probing stays short.
+  size_t capacity = 1;
+
+  while (capacity < (size_t)array->size * 2) {
+    capacity <<= 1;
+  }
+
+  if ((hashes = malloc(sizeof(unsigned long long) * array->size)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  // Every slot holds the upper half of a hash and the index of the string
+  // kept plus one, 0 marks an empty slot.
+  if ((slots = calloc(capacity, sizeof(unsigned long long))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  string_array_entry *entries = array->entries;
+  char *buffer = array->buffer;
+  unsigned int size = array->size;
+  size_t mask = capacity - 1;
+  unsigned int kept = 0;   // Number of strings kept so far.
+  unsigned int bytes = 0;  // Bytes used by the strings kept.
+
+  // Hashing first lets the lookups be prefetched.
+  for (unsigned int i = 0; i < size; i++) {
+    hashes[i] = hash_string(buffer + entries[i].offset, entries[i].length);
+  }
+
+  for (unsigned int i = 0; i < size; i++) {
+    // The slot of a string is fetched first, then the string it holds, so
+    // both are in cache once the string is looked up.
+    if (i + STRING_ARRAY_PREFETCH_DISTANCE < size) {
+      __builtin_prefetch(
+          &slots[hashes[i + STRING_ARRAY_PREFETCH_DISTANCE] & mask]);
+    }
+
+    if (i + STRING_ARRAY_PREFETCH_DISTANCE / 2 < size) {
+      unsigned long long entry =
+          slots[hashes[i + STRING_ARRAY_PREFETCH_DISTANCE / 2] & mask];
+
+      if (entry != 0) {
+        __builtin_prefetch(buffer + entries[(entry & 0xffffffff) - 1].offset);
+      }
+    }
+
+    unsigned long long tag = hashes[i] >> 32;
+    size_t slot = hashes[i] & mask;
+    string_array_entry current = entries[i];
+
+    while (slots[slot] != 0) {
+      unsigned long long entry = slots[slot];
+      string_array_entry other = entries[(entry & 0xffffffff) - 1];
+
+      if (entry >> 32 == tag && other.length == current.length &&
+          memcmp(buffer + other.offset, buffer + current.offset,
+                 current.length) == 0) {
+        break;
+      }
+
+      slot = (slot + 1) & mask;
+    }
+
+    if (slots[slot] != 0) {
+      continue;
+    }
+
+    // Strings kept are packed at the start of the buffer, never past the
+    // strings still to be read.
+    memmove(buffer + bytes, buffer + current.offset, current.length + 1);
+    entries[kept].offset = bytes;
+    entries[kept++].length = current.length;
+    bytes += current.length + 1;
+    slots[slot] = tag << 32 | kept;
+  }
+
+  array->size = kept;
+  array->bytes = bytes;
+
+defer:
+  free(hashes);
+  free(slots);
+  return result;
+}
+
+int string_array_get_size(string_array *array) {
+  if (array == NULL) {
+    return -1;
+  }
+  return array->size;
+}
+
+void string_array_clear(string_array *array) {
+  if (array != NULL) {
+    array->bytes = 0;
+    array->size = 0;
+  }
+}
+
+void string_array_destroy(string_array **array) {
+  if (*array != NULL) {
+    free((*array)->buffer);
+    free((*array)->entries);
+    free(*array);
+    *array = NULL;
+  }
+}
@@ -1,16 +1,91 @@
 #include "string_builder.h"
 
+#include <math.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "logger.h"
 
-struct string_builder {
-  dynamic_array *string;  // string being built
+#define STRING_BUILDER_INITIAL_CAPACITY 16
+// Longest decimal unsigned long(20 digits) plus a sign.
+#define STRING_BUILDER_LONG_DIGITS 21
+// Longest double written by string_builder_append_double, e.g.
+// -1.2345678901234567e-308 or -0.0000012345678901234567.
+#define STRING_BUILDER_DOUBLE_DIGITS 32
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Normalized 64 bit significands and binary exponents of 10^-348, 10^-340,
+// ..., 10^340, used to scale a double so its digits can be read off the
+// integer part.
+static const unsigned long long cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+static const short cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635,
+    -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316,
+    -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56,
+    83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853,
+    880, 907, 933, 960, 986, 1013, 1039, 1066,
 };
 
+static const unsigned long long powers_of_ten[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+    1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+// Floating point number f * 2^e with a 64 bit significand.
+typedef struct diy_fp {
+  unsigned long long f;
+  int e;
+} diy_fp;
+
 int string_builder_create(string_builder **sb) {
   int result = STATUS_SUCCESS;
 
@@ -18,89 +93,598 @@ int string_builder_create(string_builder **sb) {
     RETURN_DEFER(STATUS_MEMORY_FAILURE);
   }
 
-  result = dynamic_array_create(&(*sb)->string, sizeof(char), NULL, NULL);
+  string_builder_init(*sb, NULL, 0);
 
 defer:
   return result;
 }
 
-int string_builder_append(string_builder *sb, const char *str,
-                          unsigned int length) {
-  return dynamic_array_add_many(sb->string, (void **)str, length);
+void string_builder_init(string_builder *sb, char *buffer, size_t capacity) {
+  sb->data = buffer;
+  sb->length = 0;
+  sb->capacity = buffer != NULL ? capacity : 0;
+  sb->borrowed = buffer != NULL;
+}
+
+/**
+ * Move the characters to memory of a given capacity.
+ *
+ * Memory owned by the builder is resized, a borrowed buffer is copied out
+ * of and left untouched.
+ *
+ * @return 0 on success, 2 indicates memory allocation failure.
+ */
+static int string_builder_resize(string_builder *sb, size_t capacity) {
+  int result = STATUS_SUCCESS;
+  char *data = NULL;
+
+  if (sb->borrowed) {
+    if ((data = malloc(capacity)) == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    memcpy(data, sb->data, sb->length);
+    sb->borrowed = 0;
+  } else if ((data = realloc(sb->data, capacity)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  sb->data = data;
+  sb->capacity = capacity;
+
+defer:
+  return result;
 }
 
-int string_builder_append_char(string_builder *sb, const char ch) {
-  return dynamic_array_add(sb->string, &ch);
+int string_builder_grow(string_builder *sb, size_t additional) {
+  size_t capacity = sb->capacity == 0 ? STRING_BUILDER_INITIAL_CAPACITY
+                                      : sb->capacity << 1;
+
+  if (capacity < sb->length + additional) {
+    capacity = sb->length + additional;
+  }
+
+  return string_builder_resize(sb, capacity);
+}
+
+int string_builder_reserve(string_builder *sb, size_t capacity) {
+  int result = STATUS_SUCCESS;
+
+  if (capacity <= sb->capacity) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  result = string_builder_resize(sb, capacity);
+
+defer:
+  return result;
+}
+
+void string_builder_clear(string_builder *sb) { sb->length = 0; }
+
+int string_builder_truncate(string_builder *sb, size_t length) {
+  int result = STATUS_SUCCESS;
+
+  if (length > sb->length) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+  sb->length = length;
+
+defer:
+  return result;
 }
 
 int string_builder_append_fmtstr(string_builder *sb, const char *format, ...) {
-  // man vsnprintf example.
   int result = STATUS_SUCCESS;
   // number of characters the formatted string will contain
   // excluding the null byte.
   int num_chars = 0;
-  // number bytes to allocate.
-  int size = 0;
-  // temp buffer to store formatted string.
-  char *buffer = NULL;
   va_list args;
 
+  // Format straight into the spare capacity. vsnprintf needs room for the
+  // null byte, which is not counted in the length.
   va_start(args, format);
-  num_chars = vsnprintf(buffer, size, format, args);
+  num_chars = vsnprintf(sb->capacity > sb->length ? sb->data + sb->length
+                                                  : NULL,
+                        sb->capacity - sb->length, format, args);
   va_end(args);
 
-  size = num_chars + 1;  // extra byte for '\0'
-
-  if ((buffer = malloc(size)) == NULL) {
-    LOG_ERROR("failed to allocate memory for buffer");
-    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  if (num_chars < 0) {
+    RETURN_DEFER(STATUS_FAILURE);
   }
 
-  va_start(args, format);
-  num_chars = vsnprintf(buffer, size, format, args);
-  va_end(args);
+  // Output was truncated, grow and format again.
+  if ((size_t)num_chars >= sb->capacity - sb->length) {
+    if (string_builder_grow(sb, num_chars + 1) != 0) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
 
-  if ((string_builder_append(sb, buffer, num_chars)) != 0) {
-    RETURN_DEFER(STATUS_FAILURE);
+    va_start(args, format);
+    num_chars = vsnprintf(sb->data + sb->length, sb->capacity - sb->length,
+                          format, args);
+    va_end(args);
   }
 
+  sb->length += num_chars;
+
 defer:
-  if (buffer != NULL) {
-    free(buffer);
-  }
   return result;
 }
 
+/**
+ * Write the digits of value backwards, two at a time, ending right before
+ * 'end'.
+ *
+ * @return pointer to the first digit.
+ */
+static char *format_ulong(unsigned long value, char *end) {
+  while (value >= 100) {
+    unsigned int pair = (value % 100) * 2;
+
+    value /= 100;
+    *--end = digit_pairs[pair + 1];
+    *--end = digit_pairs[pair];
+  }
+
+  if (value >= 10) {
+    *--end = digit_pairs[value * 2 + 1];
+    *--end = digit_pairs[value * 2];
+  } else {
+    *--end = '0' + value;
+  }
+
+  return end;
+}
+
+int string_builder_append_long(string_builder *sb, long value) {
+  char buffer[STRING_BUILDER_LONG_DIGITS];
+  char *end = buffer + sizeof(buffer);
+  // Negate as unsigned so LONG_MIN doesn't overflow.
+  unsigned long magnitude =
+      value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+  char *start = format_ulong(magnitude, end);
+
+  if (value < 0) {
+    *--start = '-';
+  }
+
+  return string_builder_append(sb, start, end - start);
+}
+
+int string_builder_append_ulong(string_builder *sb, unsigned long value) {
+  char buffer[STRING_BUILDER_LONG_DIGITS];
+  char *end = buffer + sizeof(buffer);
+  char *start = format_ulong(value, end);
+
+  return string_builder_append(sb, start, end - start);
+}
+
+static inline diy_fp diy_fp_normalize(diy_fp x) {
+  int shift = __builtin_clzll(x.f);
+
+  x.f <<= shift;
+  x.e -= shift;
+
+  return x;
+}
+
+/**
+ * Multiply two diy_fp keeping the upper 64 bits of the product, rounded.
+ */
+static inline diy_fp diy_fp_multiply(diy_fp a, diy_fp b) {
+  unsigned __int128 product = (unsigned __int128)a.f * b.f;
+  diy_fp x;
+
+  x.f = (unsigned long long)(product >> 64) +
+        ((unsigned long long)product >> 63);
+  x.e = a.e + b.e + 64;
+
+  return x;
+}
+
+/**
+ * Find the cached power of ten c = 10^-k that brings a number with binary
+ * exponent 'e' into the range where digits are generated.
+ */
+static inline diy_fp cached_power(int e, int *k) {
+  // ceil((-61 - e) * log10(2)) + 347 picks the smallest suitable power.
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int ik = (int)dk;
+  unsigned int index = 0;
+  diy_fp c;
+
+  if (dk - ik > 0.0) {
+    ik++;
+  }
+
+  index = (ik >> 3) + 1;
+  *k = 348 - (int)index * 8;
+  c.f = cached_powers_f[index];
+  c.e = cached_powers_e[index];
+
+  return c;
+}
+
+/**
+ * Move the last digit towards w while the result stays inside the rounding
+ * interval, so the shortest output is also the closest one.
+ *
+ * w is only known within ulp, the digits are kept when they are the
+ * closest and inside the interval wherever w is in that range.
+ *
+ * @return whether the digits are known to be the shortest and closest.
+ */
+static inline bool round_weed(char *buffer, int length,
+                              unsigned long long delta,
+                              unsigned long long rest,
+                              unsigned long long ten_kappa,
+                              unsigned long long wp_w,
+                              unsigned long long ulp) {
+  unsigned long long wp_w_up = wp_w - ulp;
+  unsigned long long wp_w_down = wp_w + ulp;
+
+  while (rest < wp_w_up && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w_up ||
+          wp_w_up - rest >= rest + ten_kappa - wp_w_up)) {
+    buffer[length - 1]--;
+    rest += ten_kappa;
+  }
+
+  // One more step could also be right for the largest w.
+  if (rest < wp_w_down && delta - rest >= ten_kappa &&
+      (rest + ten_kappa < wp_w_down ||
+       wp_w_down - rest > rest + ten_kappa - wp_w_down)) {
+    return false;
+  }
+
+  // The digits must stay inside the interval whatever its rounding error.
+  return 2 * ulp <= rest && rest <= delta - 4 * ulp;
+}
+
+/**
+ * Generate the fewest digits of mp that still lie within delta of it.
+ *
+ * mp and delta are one unit wider than the rounding interval on each
+ * side, round_weed tells whether that unit of error matters.
+ *
+ * @return whether the digits are known to be the shortest and closest.
+ */
+static bool digit_gen(diy_fp w, diy_fp mp, unsigned long long delta,
+                      char *buffer, int *length, int *k) {
+  int shift = -mp.e;
+  unsigned long long one = 1ULL << shift;
+  unsigned long long wp_w = mp.f - w.f;
+  unsigned long long unit = 1;
+  unsigned int p1 = mp.f >> shift;
+  unsigned long long p2 = mp.f & (one - 1);
+  int kappa = 1;
+
+  while (kappa < 10 && p1 >= powers_of_ten[kappa]) {
+    kappa++;
+  }
+
+  *length = 0;
+
+  // Digits of the integer part.
+  while (kappa > 0) {
+    unsigned int digit = p1 / powers_of_ten[kappa - 1];
+    unsigned long long rest = 0;
+
+    p1 %= powers_of_ten[kappa - 1];
+
+    if (digit != 0 || *length != 0) {
+      buffer[(*length)++] = '0' + digit;
+    }
+
+    kappa--;
+    rest = ((unsigned long long)p1 << shift) + p2;
+
+    if (rest < delta) {
+      *k += kappa;
+      return round_weed(buffer, *length, delta, rest,
+                        powers_of_ten[kappa] << shift, wp_w, unit);
+    }
+  }
+
+  // Digits of the fractional part.
+  while (1) {
+    unsigned int digit = 0;
+
+    p2 *= 10;
+    delta *= 10;
+    unit *= 10;
+    digit = p2 >> shift;
+
+    if (digit != 0 || *length != 0) {
+      buffer[(*length)++] = '0' + digit;
+    }
+
+    p2 &= one - 1;
+    kappa--;
+
+    if (p2 < delta) {
+      *k += kappa;
+      return round_weed(buffer, *length, delta, p2, one, wp_w * unit, unit);
+    }
+  }
+}
+
+/**
+ * Grisu3: write the shortest digits of a positive, finite, non zero double
+ * so that digits * 10^k reads back as value.
+ *
+ * @return false for the few values(well under 1%) where 64 bits of
+ *         precision can't tell which digits are the shortest.
+ */
+static bool grisu3(double value, char *buffer, int *length, int *k) {
+  unsigned long long bits = 0;
+  unsigned long long hidden_bit = 1ULL << 52;
+  int biased_exponent = 0;
+  diy_fp v;
+  diy_fp plus;
+  diy_fp minus;
+  diy_fp c;
+
+  memcpy(&bits, &value, sizeof(bits));
+  biased_exponent = (bits >> 52) & 0x7FF;
+  v.f = bits & (hidden_bit - 1);
+
+  if (biased_exponent != 0) {
+    v.f += hidden_bit;
+    v.e = biased_exponent - 1075;
+  } else {
+    v.e = -1074;
+  }
+
+  // Boundaries halfway to the neighbouring doubles, the lower one is
+  // closer when the significand is a power of 2.
+  plus.f = (v.f << 1) + 1;
+  plus.e = v.e - 1;
+  plus = diy_fp_normalize(plus);
+
+  if (v.f == hidden_bit) {
+    minus.f = (v.f << 2) - 1;
+    minus.e = v.e - 2;
+  } else {
+    minus.f = (v.f << 1) - 1;
+    minus.e = v.e - 1;
+  }
+
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  c = cached_power(plus.e, k);
+  v = diy_fp_multiply(diy_fp_normalize(v), c);
+  plus = diy_fp_multiply(plus, c);
+  minus = diy_fp_multiply(minus, c);
+  // Widen the interval by the rounding error of the multiplications, one
+  // unit on each side.
+  minus.f--;
+  plus.f++;
+
+  return digit_gen(v, plus, plus.f - minus.f, buffer, length, k);
+}
+
+/**
+ * Find the shortest digits by asking printf for the fewest of them that
+ * read back as value, for when grisu3 can't tell.
+ *
+ * grisu3 leaves the shortest digits of an interval wider than the one
+ * of value in buffer, nothing shorter than them can read back as value.
+ */
+static void shortest_digits(double value, char *buffer, int *length,
+                            int *k) {
+  // d.ddddddddddddddddde-308 and its null byte.
+  char formatted[32];
+  char *exponent = NULL;
+  // Digits after the point, 16 of them always read back as the same double.
+  int low = *length - 1;
+  int high = 16;
+  int precision = low;
+  int formatted_precision = -1;
+
+  // Once enough digits read back as value, more of them do too. The digits
+  // left by grisu3 are most often enough, or one short.
+  while (low < high) {
+    snprintf(formatted, sizeof(formatted), "%.*e", precision, value);
+    formatted_precision = precision;
+
+    if (strtod(formatted, NULL) == value) {
+      high = precision;
+    } else {
+      low = precision + 1;
+    }
+
+    precision = low + (high - low) / 2;
+  }
+
+  if (formatted_precision != low) {
+    snprintf(formatted, sizeof(formatted), "%.*e", low, value);
+  }
+
+  // Drop the point and the exponent, and the trailing zeros.
+  exponent = strchr(formatted, 'e');
+  buffer[0] = formatted[0];
+  *length = 1;
+
+  for (char *digit = formatted + 2; digit < exponent; digit++) {
+    buffer[(*length)++] = *digit;
+  }
+
+  while (*length > 1 && buffer[*length - 1] == '0') {
+    (*length)--;
+  }
+
+  *k = atoi(exponent + 1) - (*length - 1);
+}
+
+/**
+ * Write 'e' followed by the decimal exponent.
+ *
+ * @return pointer past the last character written.
+ */
+static char *write_exponent(int exponent, char *buffer) {
+  *buffer++ = 'e';
+
+  if (exponent < 0) {
+    *buffer++ = '-';
+    exponent = -exponent;
+  }
+
+  if (exponent >= 100) {
+    *buffer++ = '0' + exponent / 100;
+    exponent %= 100;
+    *buffer++ = digit_pairs[exponent * 2];
+    *buffer++ = digit_pairs[exponent * 2 + 1];
+  } else if (exponent >= 10) {
+    *buffer++ = digit_pairs[exponent * 2];
+    *buffer++ = digit_pairs[exponent * 2 + 1];
+  } else {
+    *buffer++ = '0' + exponent;
+  }
+
+  return buffer;
+}
+
+/**
+ * Lay out digits * 10^k in place as a decimal or in exponent notation.
+ *
+ * @return pointer past the last character written.
+ */
+static char *prettify(char *buffer, int length, int k) {
+  // 10^(point - 1) <= value < 10^point
+  int point = length + k;
+
+  if (k >= 0 && point <= 21) {
+    // 1234e7 -> 12340000000.0
+    memset(buffer + length, '0', point - length);
+    buffer[point] = '.';
+    buffer[point + 1] = '0';
+    return buffer + point + 2;
+  }
+
+  if (point > 0 && point <= 21) {
+    // 1234e-2 -> 12.34
+    memmove(buffer + point + 1, buffer + point, length - point);
+    buffer[point] = '.';
+    return buffer + length + 1;
+  }
+
+  if (point > -6 && point <= 0) {
+    // 1234e-6 -> 0.001234
+    int offset = 2 - point;
+
+    memmove(buffer + offset, buffer, length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', offset - 2);
+    return buffer + length + offset;
+  }
+
+  if (length == 1) {
+    // 1e30
+    return write_exponent(point - 1, buffer + 1);
+  }
+
+  // 1234e30 -> 1.234e33
+  memmove(buffer + 2, buffer + 1, length - 1);
+  buffer[1] = '.';
+  return write_exponent(point - 1, buffer + length + 1);
+}
+
+int string_builder_append_double(string_builder *sb, double value) {
+  char buffer[STRING_BUILDER_DOUBLE_DIGITS];
+  char *start = buffer;
+  char *end = NULL;
+  int length = 0;
+  int k = 0;
+
+  if (isnan(value)) {
+    return string_builder_append(sb, "nan", 3);
+  }
+
+  if (signbit(value)) {
+    *start++ = '-';
+    value = -value;
+  }
+
+  if (isinf(value)) {
+    memcpy(start, "inf", 3);
+    end = start + 3;
+  } else if (value == 0.0) {
+    memcpy(start, "0.0", 3);
+    end = start + 3;
+  } else {
+    if (!grisu3(value, start, &length, &k)) {
+      shortest_digits(value, start, &length, &k);
+    }
+    end = prettify(start, length, k);
+  }
+
+  return string_builder_append(sb, buffer, end - buffer);
+}
+
 int string_builder_build(string_builder *sb, char **buffer) {
   int result = STATUS_SUCCESS;
 
-  if ((dynamic_array_shrink_to_fit(sb->string)) != 0) {
-    RETURN_DEFER(STATUS_FAILURE);
+  if (((*buffer) = malloc(sb->length + 1)) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
   }
 
-  int bytes = sizeof(char) * dynamic_array_get_size(sb->string);
+  if (sb->length > 0) {
+    memcpy(*buffer, sb->data, sb->length);
+  }
+  (*buffer)[sb->length] = '\0';
+
+defer:
+  return result;
+}
 
-  if (((*buffer) = malloc(bytes + 1)) == NULL) {
+int string_builder_steal(string_builder *sb, char **buffer) {
+  int result = STATUS_SUCCESS;
+
+  // Make room for the null byte, a borrowed buffer can't be handed over
+  // and is copied instead.
+  if ((sb->length == sb->capacity || sb->borrowed) &&
+      string_builder_resize(sb, sb->length + 1) != 0) {
     RETURN_DEFER(STATUS_MEMORY_FAILURE);
   }
 
-  void *item = NULL;
-  dynamic_array_find_ref(sb->string, 0, &item);
+  sb->data[sb->length] = '\0';
+  *buffer = sb->data;
 
-  memcpy(*buffer, item, bytes);
-  (*buffer)[bytes] = '\0';
+  string_builder_init(sb, NULL, 0);
 
 defer:
   return result;
 }
 
-int string_builder_is_empty(string_builder *sb) {
-  return dynamic_array_is_empty(sb->string);
+const char *string_builder_view(string_builder *sb) {
+  // Make room for the null byte.
+  if (sb->length == sb->capacity && string_builder_grow(sb, 1) != 0) {
+    return NULL;
+  }
+
+  // The null byte sits in the spare capacity, length is unchanged.
+  sb->data[sb->length] = '\0';
+
+  return sb->data;
+}
+
+int string_builder_is_empty(string_builder *sb) { return sb->length == 0; }
+
+void string_builder_release(string_builder *sb) {
+  if (!sb->borrowed) {
+    free(sb->data);
+  }
+
+  string_builder_init(sb, NULL, 0);
 }
 
 void string_builder_destroy(string_builder **sb) {
   if (*sb != NULL) {
-    dynamic_array_destroy(&(*sb)->string);
+    string_builder_release(*sb);
 
     free(*sb);
     (*sb) = NULL;
@@ -1,139 +1,1322 @@
 #include "string_slice.h"
 
-#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// SSSE3 is not assumed, the UTF-8 validator using it is picked at run time.
+#if defined(__x86_64__) || defined(__i386__)
+#define STRING_SLICE_UTF8_SSSE3
+#include <tmmintrin.h>
+#endif
+
 #include "logger.h"
 
-struct string_slice {
-  char *string;
-  unsigned int length;
+// Sets with more characters are searched with a lookup table instead.
+#define STRING_SLICE_VECTOR_SET_MAX 32
+// Larger sets take longer to set up for the vector loop, the first
+// characters are compared one at a time before it.
+#define STRING_SLICE_SMALL_SET_MAX 8
+// Longer needles are searched for with the Two-Way algorithm.
+#define STRING_SLICE_FIND_SHORT_MAX 64
+// Numbers at most this long are copied to the stack for strtod.
+#define STRING_SLICE_NUMBER_CAPACITY 64
+// Mantissas up to 2^53 are exact in a double.
+#define STRING_SLICE_EXACT_MANTISSA (1ULL << 53)
+
+const unsigned char string_slice_classes[256] = {
+    [' '] = STRING_SLICE_WHITESPACE,  ['\t'] = STRING_SLICE_WHITESPACE,
+    ['\n'] = STRING_SLICE_WHITESPACE, ['\v'] = STRING_SLICE_WHITESPACE,
+    ['\f'] = STRING_SLICE_WHITESPACE, ['\r'] = STRING_SLICE_WHITESPACE,
+    [','] = STRING_SLICE_DELIMITER,   ['='] = STRING_SLICE_DELIMITER,
+    ['"'] = STRING_SLICE_QUOTE,       ['\''] = STRING_SLICE_QUOTE,
+    ['-'] = STRING_SLICE_PREFIX,      ['+'] = STRING_SLICE_PREFIX,
 };
 
-int string_slice_create(string_slice **ss, char *str, unsigned int length) {
-  int result = STATUS_SUCCESS;
+/**
+ * Find the first character of ss[index..] in set, one character at a time.
+ */
+static size_t find_any_scalar(string_slice ss, size_t index, const char *set,
+                              size_t set_length) {
+  // Few characters left after the vector loop, skip building the table.
+  if (set_length <= STRING_SLICE_SMALL_SET_MAX) {
+    while (index < ss.len && memchr(set, ss.ptr[index], set_length) == NULL) {
+      index++;
+    }
+    return index;
+  }
 
-  if ((*ss = malloc(sizeof(string_slice))) == NULL) {
-    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  unsigned char in_set[256] = {0};
+
+  for (size_t i = 0; i < set_length; i++) {
+    in_set[(unsigned char)set[i]] = 1;
   }
-  (*ss)->string = str;
-  (*ss)->length = length;
 
-defer:
-  return result;
+  while (index < ss.len && !in_set[(unsigned char)ss.ptr[index]]) {
+    index++;
+  }
+
+  return index;
+}
+
+#if defined(__AVX2__)
+/**
+ * Compare thirty two characters at a time against every character in set.
+ *
+ * @return index of the first match, or of the first character left for
+ *         the scalar loop.
+ */
+static inline size_t find_any_vector(string_slice ss, size_t index,
+                                     const char *set, size_t set_length,
+                                     char *found) {
+  __m256i needles[STRING_SLICE_VECTOR_SET_MAX];
+
+  for (size_t i = 0; i < set_length; i++) {
+    needles[i] = _mm256_set1_epi8(set[i]);
+  }
+
+  for (; index + 32 <= ss.len; index += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(ss.ptr + index));
+    __m256i matches = _mm256_cmpeq_epi8(chunk, needles[0]);
+
+    for (size_t i = 1; i < set_length; i++) {
+      matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, needles[i]));
+    }
+
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(matches);
+    if (mask != 0) {
+      *found = 1;
+      return index + __builtin_ctz(mask);
+    }
+  }
+
+  return index;
 }
+#elif defined(__SSE2__)
+/**
+ * Compare sixteen characters at a time against every character in set.
+ *
+ * @return index of the first match, or of the first character left for
+ *         the scalar loop.
+ */
+static inline size_t find_any_vector(string_slice ss, size_t index,
+                                     const char *set, size_t set_length,
+                                     char *found) {
+  __m128i needles[STRING_SLICE_VECTOR_SET_MAX];
 
-int string_slice_advance(string_slice **ss) {
+  for (size_t i = 0; i < set_length; i++) {
+    needles[i] = _mm_set1_epi8(set[i]);
+  }
+
+  for (; index + 16 <= ss.len; index += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(ss.ptr + index));
+    __m128i matches = _mm_cmpeq_epi8(chunk, needles[0]);
+
+    for (size_t i = 1; i < set_length; i++) {
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, needles[i]));
+    }
+
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(matches);
+    if (mask != 0) {
+      *found = 1;
+      return index + __builtin_ctz(mask);
+    }
+  }
+
+  return index;
+}
+#endif
+
+#if defined(__SSE2__)
+/**
+ * Compare the characters of ss[index..end) one at a time against a set of
+ * 9 to 32 characters held in two vectors. Both are loaded from the ends of
+ * set and overlap when it is shorter, nothing past it is read.
+ *
+ * @return index of the first match, end if there is none.
+ */
+static size_t find_any_loaded(string_slice ss, size_t index, size_t end,
+                              const char *set, size_t set_length) {
+  __m128i first;
+  __m128i second;
+
+  if (set_length <= 16) {
+    first = _mm_unpacklo_epi64(
+        _mm_loadl_epi64((const __m128i *)set),
+        _mm_loadl_epi64((const __m128i *)(set + set_length - 8)));
+    second = first;
+  } else {
+    first = _mm_loadu_si128((const __m128i *)set);
+    second = _mm_loadu_si128((const __m128i *)(set + set_length - 16));
+  }
+
+  for (; index < end; index++) {
+    __m128i ch = _mm_set1_epi8(ss.ptr[index]);
+
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(ch, first),
+                                       _mm_cmpeq_epi8(ch, second))) != 0) {
+      break;
+    }
+  }
+
+  return index;
+}
+#endif
+
+size_t string_slice_find_any(string_slice ss, const char *set,
+                             size_t set_length) {
+  size_t index = 0;
+
+  if (ss.ptr == NULL || set == NULL || set_length == 0) {
+    return ss.len;
+  }
+
+  if (set_length == 1) {
+    const char *found = memchr(ss.ptr, set[0], ss.len);
+    return found != NULL ? (size_t)(found - ss.ptr) : ss.len;
+  }
+
+#if defined(__SSE2__)
+  if (set_length > STRING_SLICE_SMALL_SET_MAX &&
+      set_length <= STRING_SLICE_VECTOR_SET_MAX) {
+    size_t head = ss.len < 16 ? ss.len : 16;
+
+    // Fields are often only a few characters long, their end is found
+    // before the comparisons against every character are set up.
+    index = find_any_loaded(ss, 0, head, set, set_length);
+    if (index < head) {
+      return index;
+    }
+  }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  if (set_length <= STRING_SLICE_VECTOR_SET_MAX) {
+    char found = 0;
+
+    index = find_any_vector(ss, index, set, set_length, &found);
+    if (found) {
+      return index;
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  if (set_length > STRING_SLICE_SMALL_SET_MAX &&
+      set_length <= STRING_SLICE_VECTOR_SET_MAX) {
+    return find_any_loaded(ss, index, ss.len, set, set_length);
+  }
+#endif
+
+  return find_any_scalar(ss, index, set, set_length);
+}
+
+int string_slice_cmp(string_slice a, string_slice b) {
+  size_t length = a.len < b.len ? a.len : b.len;
+  int result = length > 0 ? memcmp(a.ptr, b.ptr, length) : 0;
+
+  if (result != 0) {
+    return result;
+  }
+
+  // The shorter slice is a prefix of the other one.
+  return (a.len > b.len) - (a.len < b.len);
+}
+
+int string_slice_casecmp(string_slice a, string_slice b) {
+  size_t length = a.len < b.len ? a.len : b.len;
+
+  for (size_t i = 0; i < length; i++) {
+    int ch_a = (unsigned char)a.ptr[i];
+    int ch_b = (unsigned char)b.ptr[i];
+
+    if (ch_a >= 'A' && ch_a <= 'Z') {
+      ch_a += 'a' - 'A';
+    }
+
+    if (ch_b >= 'A' && ch_b <= 'Z') {
+      ch_b += 'a' - 'A';
+    }
+
+    if (ch_a != ch_b) {
+      return ch_a - ch_b;
+    }
+  }
+
+  return (a.len > b.len) - (a.len < b.len);
+}
+
+unsigned int string_slice_hash(string_slice ss) {
+  unsigned int hash_value = 2166136261U;
+
+  for (size_t i = 0; i < ss.len; i++) {
+    hash_value ^= (unsigned char)ss.ptr[i];
+    hash_value *= 16777619;
+  }
+
+  return hash_value;
+}
+
+#if defined(__SSE2__)
+/**
+ * Mask of the positions in the sixteen starting at p whose first and last
+ * two characters are those of the needle.
+ */
+static inline unsigned int filter_block(const char *p, size_t last_offset,
+                                        __m128i first, __m128i before_last,
+                                        __m128i last) {
+  __m128i block_first = _mm_loadu_si128((const __m128i *)p);
+  __m128i block_before_last =
+      _mm_loadu_si128((const __m128i *)(p + last_offset - 1));
+  __m128i block_last = _mm_loadu_si128((const __m128i *)(p + last_offset));
+  __m128i matches =
+      _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                    _mm_cmpeq_epi8(block_before_last, before_last));
+
+  return (unsigned int)_mm_movemask_epi8(
+      _mm_and_si128(matches, _mm_cmpeq_epi8(block_last, last)));
+}
+
+/**
+ * Find a needle of at least two characters by filtering thirty two
+ * positions at a time on its first and last two characters. The last pair
+ * keeps few candidates for memcmp even when the alphabet is small or the
+ * first and last characters are common ones.
+ *
+ * @return index of the first occurrence, or of the first position left for
+ *         the scalar loop when 'found' is not set.
+ */
+static size_t find_filtered(string_slice haystack, string_slice needle,
+                            char *found) {
+  const __m128i first = _mm_set1_epi8(needle.ptr[0]);
+  const __m128i before_last = _mm_set1_epi8(needle.ptr[needle.len - 2]);
+  const __m128i last = _mm_set1_epi8(needle.ptr[needle.len - 1]);
+  size_t offset = needle.len - 1;
+  size_t index = 0;
+
+  for (; index + offset + 32 <= haystack.len; index += 32) {
+    const char *p = haystack.ptr + index;
+    unsigned int mask =
+        filter_block(p, offset, first, before_last, last) |
+        filter_block(p + 16, offset, first, before_last, last) << 16;
+
+    while (mask != 0) {
+      size_t candidate = index + __builtin_ctz(mask);
+
+      if (memcmp(haystack.ptr + candidate + 1, needle.ptr + 1,
+                 needle.len - 2) == 0) {
+        *found = 1;
+        return candidate;
+      }
+
+      mask &= mask - 1;
+    }
+  }
+
+  return index;
+}
+#endif
+
+/**
+ * Split the needle at a critical position for the Two-Way algorithm.
+ *
+ * The needle is factored using the larger of its maximal suffixes for
+ * the normal and the reversed alphabet order.
+ *
+ * @param needle characters to factor.
+ * @param length number of characters in needle.
+ * @param period where to store the period of the right half.
+ *
+ * @return length of the left half.
+ */
+static size_t critical_factorization(const unsigned char *needle,
+                                     size_t length, size_t *period) {
+  size_t suffix[2];
+  size_t periods[2];
+
+  for (int reverse = 0; reverse < 2; reverse++) {
+    // Suffixes start out at -1 so suffix + k is the character before k.
+    size_t max_suffix = SIZE_MAX;
+    size_t j = 0;
+    size_t k = 1;
+    size_t p = 1;
+
+    while (j + k < length) {
+      unsigned char a = needle[j + k];
+      unsigned char b = needle[max_suffix + k];
+
+      if (reverse ? b < a : a < b) {
+        // Suffix is smaller, period is the whole prefix so far.
+        j += k;
+        k = 1;
+        p = j - max_suffix;
+      } else if (a == b) {
+        // Advance through a repetition of the current period.
+        if (k != p) {
+          k++;
+        } else {
+          j += p;
+          k = 1;
+        }
+      } else {
+        // Suffix is larger, it becomes the new maximal suffix.
+        max_suffix = j++;
+        k = p = 1;
+      }
+    }
+
+    suffix[reverse] = max_suffix + 1;
+    periods[reverse] = p;
+  }
+
+  int larger = suffix[1] >= suffix[0];
+
+  *period = periods[larger];
+  return suffix[larger];
+}
+
+/**
+ * Hash the character pair ending at p, for the pair shift table.
+ */
+static inline unsigned char pair_hash(const unsigned char *p) {
+  return (unsigned char)(p[0] - (p[-1] << 3));
+}
+
+/**
+ * Find a needle with the Two-Way algorithm.
+ *
+ * Windows whose last two characters do not match are first skipped with a
+ * bad character shift on the pair, like Horspool, before running the two
+ * halves. A pair rules out far more windows than a single character when
+ * the alphabet is small.
+ *
+ * @return index of the first occurrence, haystack.len if there is none.
+ */
+static size_t find_two_way(string_slice haystack, string_slice needle) {
+  const unsigned char *h = (const unsigned char *)haystack.ptr;
+  const unsigned char *n = (const unsigned char *)needle.ptr;
+  size_t period = 0;
+  size_t suffix = critical_factorization(n, needle.len, &period);
+  size_t shift_table[256];
+  size_t pair_shift[256];
+  size_t j = 0;
+
+  // Distance from the last occurrence of a character, or of a pair of
+  // characters, to the needle's end. Pairs that hash alike keep the
+  // smallest distance.
+  for (size_t i = 0; i < 256; i++) {
+    shift_table[i] = needle.len;
+    pair_shift[i] = needle.len - 1;
+  }
+
+  for (size_t i = 0; i < needle.len; i++) {
+    shift_table[n[i]] = needle.len - i - 1;
+  }
+
+  for (size_t i = 1; i < needle.len; i++) {
+    pair_shift[pair_hash(n + i)] = needle.len - i - 1;
+  }
+
+  if (memcmp(n, n + period, suffix) == 0) {
+    // Periodic needle, remember how much of the left half already matched.
+    size_t memory = 0;
+
+    while (j <= haystack.len - needle.len) {
+      size_t shift = memory != 0
+                         ? shift_table[h[j + needle.len - 1]]
+                         : pair_shift[pair_hash(h + j + needle.len - 1)];
+
+      // Another pair with the same hash, the halves never check the last
+      // character.
+      if (shift == 0 && h[j + needle.len - 1] != n[needle.len - 1]) {
+        shift = 1;
+      }
+
+      if (shift > 0) {
+        if (memory != 0 && shift < period) {
+          shift = needle.len - period;
+        }
+        memory = 0;
+        j += shift;
+        continue;
+      }
+
+      size_t i = suffix > memory ? suffix : memory;
+
+      while (i < needle.len - 1 && n[i] == h[i + j]) {
+        i++;
+      }
+
+      if (i < needle.len - 1) {
+        j += i - suffix + 1;
+        memory = 0;
+        continue;
+      }
+
+      i = suffix - 1;
+      while (memory < i + 1 && n[i] == h[i + j]) {
+        i--;
+      }
+
+      if (i + 1 < memory + 1) {
+        return j;
+      }
+
+      j += period;
+      memory = needle.len - period;
+    }
+  } else {
+    // The halves differ, a mismatch allows a shift past the larger one.
+    period = (suffix > needle.len - suffix ? suffix : needle.len - suffix) + 1;
+
+    while (j <= haystack.len - needle.len) {
+      size_t shift = pair_shift[pair_hash(h + j + needle.len - 1)];
+
+      if (shift == 0 && h[j + needle.len - 1] != n[needle.len - 1]) {
+        shift = 1;
+      }
+
+      if (shift > 0) {
+        j += shift;
+        continue;
+      }
+
+      size_t i = suffix;
+
+      while (i < needle.len - 1 && n[i] == h[i + j]) {
+        i++;
+      }
+
+      if (i < needle.len - 1) {
+        j += i - suffix + 1;
+        continue;
+      }
+
+      i = suffix - 1;
+      while (i != SIZE_MAX && n[i] == h[i + j]) {
+        i--;
+      }
+
+      if (i == SIZE_MAX) {
+        return j;
+      }
+
+      j += period;
+    }
+  }
+
+  return haystack.len;
+}
+
+size_t string_slice_find(string_slice haystack, string_slice needle) {
+  size_t index = 0;
+
+  if (needle.len == 0) {
+    return 0;
+  }
+
+  if (haystack.ptr == NULL || needle.len > haystack.len) {
+    return haystack.len;
+  }
+
+  if (needle.len == 1) {
+    const char *found = memchr(haystack.ptr, needle.ptr[0], haystack.len);
+    return found != NULL ? (size_t)(found - haystack.ptr) : haystack.len;
+  }
+
+  if (needle.len > STRING_SLICE_FIND_SHORT_MAX) {
+    return find_two_way(haystack, needle);
+  }
+
+#if defined(__SSE2__)
+  char found = 0;
+
+  index = find_filtered(haystack, needle, &found);
+  if (found) {
+    return index;
+  }
+#endif
+
+  for (; index + needle.len <= haystack.len; index++) {
+    if (haystack.ptr[index] == needle.ptr[0] &&
+        memcmp(haystack.ptr + index, needle.ptr, needle.len) == 0) {
+      return index;
+    }
+  }
+
+  return haystack.len;
+}
+
+int string_slice_split_set(string_slice *ss, string_slice *output,
+                           const char *set, size_t set_length) {
   int result = STATUS_SUCCESS;
 
-  if (*ss == NULL) {
+  if (ss->ptr == NULL) {
+    *output = string_slice_make(NULL, 0);
     RETURN_DEFER(STATUS_IS_NULL);
   }
 
-  (*ss)->length++;
+  // string slice is empty.
+  if (ss->len == 0) {
+    *output = string_slice_make(NULL, 0);
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  size_t index = string_slice_find_any(*ss, set, set_length);
+
+  *output = string_slice_make(ss->ptr, index);
+
+  // delimiter was not found.
+  if (index == ss->len) {
+    *ss = string_slice_make(NULL, 0);
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  ss->ptr += index + 1;
+  ss->len -= index + 1;
 
 defer:
   return result;
 }
 
-int string_slice_split(string_slice *ss, string_slice *output,
-                       const char delimiter) {
+int string_slice_split_any(string_slice *ss, string_slice *output,
+                           unsigned int classes) {
   int result = STATUS_SUCCESS;
 
-  if (ss->string == NULL) {
-    output->string = NULL;
-    output->length = 0;
+  if (ss->ptr == NULL) {
+    *output = string_slice_make(NULL, 0);
     RETURN_DEFER(STATUS_IS_NULL);
   }
 
   // string slice is empty.
-  if (ss->length == 0) {
-    output->string = NULL;
-    output->length = 0;
+  if (ss->len == 0) {
+    *output = string_slice_make(NULL, 0);
     RETURN_DEFER(STATUS_IS_EMPTY);
   }
 
-  output->string = ss->string;
-  output->length = ss->length;
+  size_t index = string_slice_cspan(*ss, classes);
+
+  *output = string_slice_make(ss->ptr, index);
 
-  for (unsigned int i = 0; i < ss->length; i++) {
-    if (ss->string[i] == delimiter) {
-      ss->string += i + 1;
-      ss->length -= i + 1;
+  // delimiter was not found.
+  if (index == ss->len) {
+    *ss = string_slice_make(NULL, 0);
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
 
-      output->length = i;
+  ss->ptr += index + 1;
+  ss->len -= index + 1;
 
-      RETURN_DEFER(STATUS_SUCCESS);
+defer:
+  return result;
+}
+
+void string_slice_iter_init(string_slice_iter *it, string_slice ss,
+                            const char *set, size_t set_length) {
+  it->rest = ss;
+  it->set = set;
+  it->set_length = set_length;
+  it->done = ss.ptr == NULL;
+}
+
+int string_slice_iter_next(string_slice_iter *it, string_slice *field) {
+  int result = STATUS_SUCCESS;
+
+  if (it->done) {
+    *field = string_slice_make(NULL, 0);
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  size_t index = string_slice_find_any(it->rest, it->set, it->set_length);
+
+  *field = string_slice_make(it->rest.ptr, index);
+
+  // last field, nothing follows it.
+  if (index == it->rest.len) {
+    it->done = 1;
+    it->rest.ptr += index;
+    it->rest.len = 0;
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  it->rest.ptr += index + 1;
+  it->rest.len -= index + 1;
+
+defer:
+  return result;
+}
+
+/**
+ * Accumulate the base 10 digits of ss[*index..] into a number.
+ *
+ * @param ss string_slice to read.
+ * @param index position of the first digit, moved past the digits read.
+ * @param limit largest number allowed.
+ * @param number where to store the number.
+ *
+ * @return 0 on success,
+ *         1 indicates a character that is not a digit(or no digits),
+ *         4 indicates the number is larger than limit.
+ */
+static int parse_digits(string_slice ss, size_t *index, unsigned long limit,
+                        unsigned long *number) {
+  int result = STATUS_SUCCESS;
+  size_t start = *index;
+
+  *number = 0;
+
+  for (; *index < ss.len; (*index)++) {
+    unsigned int digit = (unsigned char)ss.ptr[*index] - '0';
+
+    if (digit > 9) {
+      RETURN_DEFER(STATUS_FAILURE);
+    }
+
+    if (*number > (limit - digit) / 10) {
+      RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
     }
+
+    *number = *number * 10 + digit;
   }
 
-  // delimiter was not found.
-  ss->string = NULL;
-  ss->length = 0;
+  if (*index == start) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
 
 defer:
   return result;
 }
 
-int string_slice_trim(string_slice *ss) {
+int string_slice_to_long(string_slice ss, long *value, size_t *error_index) {
   int result = STATUS_SUCCESS;
+  size_t index = 0;
+  unsigned long limit = LONG_MAX;
+  unsigned long number = 0;
+  char negative = 0;
 
-  // string slice must be defined.
-  if (ss->string == NULL) {
+  if (ss.ptr == NULL) {
     RETURN_DEFER(STATUS_IS_NULL);
   }
 
-  // string slice is empty.
-  if (ss->length == 0) {
+  if (ss.len == 0) {
     RETURN_DEFER(STATUS_IS_EMPTY);
   }
 
-  // trim left
-  while (ss->string[0] == ' ') {
-    ss->length--;
-    ss->string++;
+  if (ss.ptr[0] == '-' || ss.ptr[0] == '+') {
+    negative = ss.ptr[0] == '-';
+    index++;
+  }
+
+  // LONG_MIN has no positive counterpart.
+  if (negative) {
+    limit = (unsigned long)LONG_MAX + 1;
+  }
+
+  if ((result = parse_digits(ss, &index, limit, &number)) != 0) {
+    RETURN_DEFER(result);
   }
 
-  // trim right
-  while (ss->string[ss->length - 1] == ' ') {
-    ss->length--;
+  if (!negative) {
+    *value = (long)number;
+  } else if (number == limit) {
+    *value = LONG_MIN;
+  } else {
+    *value = -(long)number;
   }
 
 defer:
+  if (error_index != NULL) {
+    *error_index = index;
+  }
   return result;
 }
 
-int string_slice_to_string(string_slice *ss, char **str) {
+int string_slice_to_ulong(string_slice ss, unsigned long *value,
+                          size_t *error_index) {
   int result = STATUS_SUCCESS;
+  size_t index = 0;
+  unsigned long number = 0;
 
-  // string slice is empty.
-  if (ss->string == NULL) {
-    *str = NULL;
-    ss->length = 0;
+  if (ss.ptr == NULL) {
     RETURN_DEFER(STATUS_IS_NULL);
   }
 
-  // string slice is empty.
-  if (ss->length == 0) {
-    *str = NULL;
-    ss->string = NULL;
+  if (ss.len == 0) {
     RETURN_DEFER(STATUS_IS_EMPTY);
   }
 
-  if (((*str) = malloc(ss->length + 1)) == NULL) {
+  if (ss.ptr[0] == '+') {
+    index++;
+  }
+
+  if ((result = parse_digits(ss, &index, ULONG_MAX, &number)) != 0) {
+    RETURN_DEFER(result);
+  }
+
+  *value = number;
+
+defer:
+  if (error_index != NULL) {
+    *error_index = index;
+  }
+  return result;
+}
+
+/**
+ * Convert a copy of the slice with strtod.
+ *
+ * @return same as string_slice_to_double.
+ */
+static int to_double_slow(string_slice ss, double *value, size_t *index) {
+  int result = STATUS_SUCCESS;
+  char buffer[STRING_SLICE_NUMBER_CAPACITY];
+  char *str = buffer;
+  char *endptr = NULL;
+
+  if (ss.len >= sizeof(buffer) && (str = malloc(ss.len + 1)) == NULL) {
     RETURN_DEFER(STATUS_MEMORY_FAILURE);
   }
 
-  memcpy(*str, ss->string, ss->length);
-  (*str)[ss->length] = '\0';
+  memcpy(str, ss.ptr, ss.len);
+  str[ss.len] = '\0';
+
+  errno = 0;
+  *value = strtod(str, &endptr);
+  *index = endptr - str;
+
+  if (endptr == str) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (*index != ss.len) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (errno == ERANGE) {
+    RETURN_DEFER(STATUS_OUT_OF_BOUNDS);
+  }
+
+defer:
+  if (str != buffer) {
+    free(str);
+  }
+  return result;
+}
+
+int string_slice_to_double(string_slice ss, double *value,
+                           size_t *error_index) {
+  // Powers of ten that are exact in a double.
+  static const double powers_of_ten[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+  int result = STATUS_SUCCESS;
+  size_t index = 0;
+  uint64_t mantissa = 0;
+  int significant = 0;  // Digits stored in mantissa, leading zeros excluded.
+  int digits = 0;       // Digits read before the exponent.
+  int exponent = 0;
+  char negative = 0;
+  char exact = 1;
+
+  if (ss.ptr == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (ss.len == 0) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  if (ss.ptr[0] == '-' || ss.ptr[0] == '+') {
+    negative = ss.ptr[0] == '-';
+    index++;
+  }
+
+  for (char fraction = 0; index < ss.len; index++) {
+    unsigned int digit = (unsigned char)ss.ptr[index] - '0';
+
+    if (ss.ptr[index] == '.' && !fraction) {
+      fraction = 1;
+      continue;
+    }
+
+    if (digit > 9) {
+      break;
+    }
+
+    digits++;
+
+    if (significant == 19) {
+      // More digits than a uint64_t holds, strtod rounds them.
+      exact = 0;
+      continue;
+    }
+
+    mantissa = mantissa * 10 + digit;
+    significant += mantissa != 0;
+    exponent -= fraction;
+  }
+
+  // Only decimal numbers, like string_slice_to_long: no whitespace, hex,
+  // inf or nan.
+  if (digits == 0) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  if (index < ss.len && (ss.ptr[index] == 'e' || ss.ptr[index] == 'E')) {
+    size_t exponent_index = index + 1;
+    unsigned long value_exponent = 0;
+    char negative_exponent = 0;
+
+    if (exponent_index < ss.len && (ss.ptr[exponent_index] == '-' ||
+                                    ss.ptr[exponent_index] == '+')) {
+      negative_exponent = ss.ptr[exponent_index] == '-';
+      exponent_index++;
+    }
+
+    size_t exponent_start = exponent_index;
+    int status = parse_digits(ss, &exponent_index, 999, &value_exponent);
+
+    if (status == STATUS_SUCCESS) {
+      exponent += negative_exponent ? -(int)value_exponent
+                                    : (int)value_exponent;
+      index = exponent_index;
+    } else if (status == STATUS_OUT_OF_BOUNDS) {
+      // Too large for the fast path, strtod reports the overflow.
+      exact = 0;
+      while (exponent_index < ss.len &&
+             (unsigned int)((unsigned char)ss.ptr[exponent_index] - '0') <=
+                 9) {
+        exponent_index++;
+      }
+      index = exponent_index;
+    } else if (exponent_index > exponent_start) {
+      // Digits followed by something else, "1e5x".
+      index = exponent_index;
+    }
+  }
+
+  if (index != ss.len) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+  // Clinger's fast path: both the mantissa and the power of ten are exact,
+  // so a single multiplication or division rounds correctly.
+  if (exact && mantissa <= STRING_SLICE_EXACT_MANTISSA && exponent >= -22 &&
+      exponent <= 22) {
+    double number = (double)mantissa;
+
+    number = exponent < 0 ? number / powers_of_ten[-exponent]
+                          : number * powers_of_ten[exponent];
+    *value = negative ? -number : number;
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  result = to_double_slow(ss, value, &index);
+
+defer:
+  if (error_index != NULL) {
+    *error_index = index;
+  }
+  return result;
+}
+
+int string_slice_to_bool(string_slice ss, bool *value, size_t *error_index) {
+  static const char *const true_words[] = {"true", "yes", "on", "1"};
+  static const char *const false_words[] = {"false", "no", "off", "0"};
+  int result = STATUS_FAILURE;
+
+  if (ss.ptr == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (ss.len == 0) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  for (size_t i = 0; i < sizeof(true_words) / sizeof(true_words[0]); i++) {
+    if (string_slice_casecmp(ss, string_slice_from_cstr(true_words[i])) == 0) {
+      *value = true;
+      RETURN_DEFER(STATUS_SUCCESS);
+    }
+
+    if (string_slice_casecmp(ss, string_slice_from_cstr(false_words[i])) ==
+        0) {
+      *value = false;
+      RETURN_DEFER(STATUS_SUCCESS);
+    }
+  }
+
+defer:
+  if (error_index != NULL) {
+    *error_index = result == STATUS_SUCCESS ? ss.len : 0;
+  }
+  return result;
+}
+
+/**
+ * Index of the first non ASCII byte of ss[index..], ss.len if there is
+ * none.
+ */
+static size_t skip_ascii(string_slice ss, size_t index) {
+#if defined(__SSE2__)
+  for (; index + 16 <= ss.len; index += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(ss.ptr + index));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(chunk);
+
+    if (mask != 0) {
+      return index + __builtin_ctz(mask);
+    }
+  }
+#endif
+
+  while (index < ss.len && (unsigned char)ss.ptr[index] < 0x80) {
+    index++;
+  }
+
+  return index;
+}
+
+/**
+ * Decode the UTF-8 sequence at ss[index].
+ *
+ * @param ss string_slice to read.
+ * @param index position of the first byte of the sequence.
+ * @param codepoint where to store the code point.
+ *
+ * @return number of bytes in the sequence, 0 if it is invalid.
+ */
+static size_t decode_utf8(string_slice ss, size_t index,
+                          uint32_t *codepoint) {
+  const unsigned char *bytes = (const unsigned char *)ss.ptr + index;
+  size_t available = ss.len - index;
+  size_t length = 0;
+  unsigned char low = 0x80;   // Range of the second byte, narrower after
+  unsigned char high = 0xBF;  // E0, ED, F0 and F4.
+
+  if (bytes[0] < 0x80) {
+    *codepoint = bytes[0];
+    return 1;
+  } else if (bytes[0] < 0xC2) {
+    // Continuation byte or overlong two byte sequence.
+    return 0;
+  } else if (bytes[0] < 0xE0) {
+    length = 2;
+    *codepoint = bytes[0] & 0x1F;
+  } else if (bytes[0] < 0xF0) {
+    length = 3;
+    *codepoint = bytes[0] & 0x0F;
+    low = bytes[0] == 0xE0 ? 0xA0 : low;
+    high = bytes[0] == 0xED ? 0x9F : high;
+  } else if (bytes[0] < 0xF5) {
+    length = 4;
+    *codepoint = bytes[0] & 0x07;
+    low = bytes[0] == 0xF0 ? 0x90 : low;
+    high = bytes[0] == 0xF4 ? 0x8F : high;
+  } else {
+    return 0;
+  }
+
+  if (available < length || bytes[1] < low || bytes[1] > high) {
+    return 0;
+  }
+
+  for (size_t i = 1; i < length; i++) {
+    if ((bytes[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    *codepoint = (*codepoint << 6) | (bytes[i] & 0x3F);
+  }
+
+  return length;
+}
+
+/**
+ * Start of the character holding ss[index], index itself unless the bytes
+ * before it begin a sequence that is not over yet.
+ */
+static size_t utf8_boundary(string_slice ss, size_t index) {
+  for (size_t back = 1; back <= 3 && back <= index; back++) {
+    unsigned char byte = (unsigned char)ss.ptr[index - back];
+    size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+
+    if (length > back) {
+      return index - back;
+    }
+  }
+
+  return index;
+}
+
+#if defined(STRING_SLICE_UTF8_SSSE3)
+// Errors found by looking at two consecutive bytes, every lookup table
+// maps a nibble to the errors it allows, a pair of bytes is invalid when
+// the three tables agree on an error.
+#define UTF8_TOO_SHORT (1 << 0)   // 11______ 0_______
+#define UTF8_TOO_LONG (1 << 1)    // 0_______ 10______
+#define UTF8_OVERLONG_3 (1 << 2)  // 11100000 100_____
+#define UTF8_TOO_LARGE (1 << 3)   // 11110100 1001____
+#define UTF8_SURROGATE (1 << 4)   // 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5)  // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6)  // 11110101 1000____
+#define UTF8_OVERLONG_4 (1 << 6)      // 11110000 1000____
+#define UTF8_TWO_CONTS (1 << 7)       // 10______ 10______
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/**
+ * Validate 16 bytes at a time with the lookup tables of Keiser and Lemire,
+ * "Validating UTF-8 In Less Than One Instruction Per Byte".
+ *
+ * @param ss string_slice to check.
+ *
+ * @return position up to which ss is valid, a character boundary. Either
+ *         the block after it holds an error or fewer than 16 bytes are
+ *         left, the rest is for decode_utf8.
+ */
+__attribute__((target("ssse3"))) static size_t validate_utf8_ssse3(
+    string_slice ss) {
+  const __m128i byte_1_high = _mm_setr_epi8(
+      // 0_______: ASCII.
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      // 10______: continuation.
+      UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+      // 1100____, 1101____: two byte lead.
+      UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,
+      // 1110____: three byte lead.
+      UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+      // 1111____: four byte lead.
+      (char)(UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 |
+             UTF8_OVERLONG_4));
+  const __m128i byte_1_low = _mm_setr_epi8(
+      // ____0000, ____0001.
+      (char)(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 |
+             UTF8_OVERLONG_4),
+      (char)(UTF8_CARRY | UTF8_OVERLONG_2),
+      // ____001_.
+      (char)UTF8_CARRY, (char)UTF8_CARRY,
+      // ____0100, ____0101.
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      // ____011_.
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      // ____1___, ____1101 also starts surrogates after 1110.
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 |
+             UTF8_SURROGATE),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+      (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+  const __m128i byte_2_high = _mm_setr_epi8(
+      // 0_______: ASCII.
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      // 1000____.
+      (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS |
+             UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+      // 1001____.
+      (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS |
+             UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+      // 101_____.
+      (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS |
+             UTF8_SURROGATE | UTF8_TOO_LARGE),
+      (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS |
+             UTF8_SURROGATE | UTF8_TOO_LARGE),
+      // 11______: lead.
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+  // A lead byte in the last 3 bytes of a block needs the next block.
+  const __m128i last_complete =
+      _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i previous = zero;
+  bool incomplete = false;  // Whether previous ends inside a sequence.
+  size_t index = 0;
+
+  for (; index + 16 <= ss.len; index += 16) {
+    __m128i input = _mm_loadu_si128((const __m128i *)(ss.ptr + index));
+
+    if (_mm_movemask_epi8(input) == 0) {
+      // Plain ASCII cannot finish a sequence.
+      if (incomplete) {
+        break;
+      }
+    } else {
+      __m128i previous_1 = _mm_alignr_epi8(input, previous, 15);
+      __m128i previous_2 = _mm_alignr_epi8(input, previous, 14);
+      __m128i previous_3 = _mm_alignr_epi8(input, previous, 13);
+      __m128i special = _mm_and_si128(
+          _mm_and_si128(
+              _mm_shuffle_epi8(
+                  byte_1_high,
+                  _mm_and_si128(_mm_srli_epi16(previous_1, 4), nibble)),
+              _mm_shuffle_epi8(byte_1_low, _mm_and_si128(previous_1, nibble))),
+          _mm_shuffle_epi8(byte_2_high,
+                           _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+      // Bytes 2 and 3 after a three or four byte lead must be
+      // continuations, the tables only check the byte after a lead.
+      __m128i must_continue = _mm_and_si128(
+          _mm_or_si128(
+              _mm_subs_epu8(previous_2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+              _mm_subs_epu8(previous_3, _mm_set1_epi8((char)(0xF0 - 0x80)))),
+          _mm_set1_epi8((char)0x80));
+
+      __m128i error = _mm_xor_si128(must_continue, special);
+
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF) {
+        break;
+      }
+
+      incomplete =
+          _mm_movemask_epi8(_mm_cmpeq_epi8(
+              _mm_subs_epu8(input, last_complete), zero)) != 0xFFFF;
+    }
+
+    previous = input;
+  }
+
+  return utf8_boundary(ss, index);
+}
+#endif
+
+int string_slice_validate_utf8(string_slice ss, size_t *error_index) {
+  int result = STATUS_SUCCESS;
+  size_t index = 0;
+  uint32_t codepoint = 0;
+
+#if defined(STRING_SLICE_UTF8_SSSE3)
+  if (ss.len >= 16 && __builtin_cpu_supports("ssse3")) {
+    index = validate_utf8_ssse3(ss);
+  }
+#endif
+
+  // Decoding finds the position of an error and checks the last bytes.
+  while ((index = skip_ascii(ss, index)) < ss.len) {
+    size_t length = decode_utf8(ss, index, &codepoint);
+
+    if (length == 0) {
+      RETURN_DEFER(STATUS_FAILURE);
+    }
+
+    index += length;
+  }
 
 defer:
+  if (error_index != NULL) {
+    *error_index = index;
+  }
   return result;
 }
 
-void string_slice_destroy(string_slice **ss) {
-  if (*ss != NULL) {
-    free(*ss);
-    *ss = NULL;
+size_t string_slice_count_codepoints(string_slice ss) {
+  size_t count = 0;
+  size_t index = 0;
+
+#if defined(__SSE2__)
+  const __m128i continuation = _mm_set1_epi8((char)0xC0);
+  const __m128i marker = _mm_set1_epi8((char)0x80);
+
+  for (; index + 16 <= ss.len; index += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(ss.ptr + index));
+    __m128i is_continuation =
+        _mm_cmpeq_epi8(_mm_and_si128(chunk, continuation), marker);
+
+    count += 16 - __builtin_popcount(_mm_movemask_epi8(is_continuation));
   }
+#endif
+
+  for (; index < ss.len; index++) {
+    count += ((unsigned char)ss.ptr[index] & 0xC0) != 0x80;
+  }
+
+  return count;
+}
+
+/**
+ * Number of columns a code point takes up: 0, 1 or 2.
+ */
+static size_t codepoint_width(uint32_t codepoint) {
+  // Sorted, non overlapping ranges of zero width code points.
+  static const uint32_t zero_width[][2] = {
+      {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD},
+      {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0E31, 0x0E31},
+      {0x0E34, 0x0E3A}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+      {0x200B, 0x200F}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F},
+      {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF},
+  };
+  // Sorted, non overlapping ranges of double width code points.
+  static const uint32_t double_width[][2] = {
+      {0x1100, 0x115F},   {0x2E80, 0x303E},   {0x3041, 0x33FF},
+      {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+      {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE30, 0xFE4F},
+      {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x1F300, 0x1F64F},
+      {0x1F900, 0x1F9FF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+  };
+
+  if (codepoint < 0x0300) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < sizeof(zero_width) / sizeof(zero_width[0]); i++) {
+    if (codepoint < zero_width[i][0]) {
+      break;
+    }
+    if (codepoint <= zero_width[i][1]) {
+      return 0;
+    }
+  }
+
+  for (size_t i = 0; i < sizeof(double_width) / sizeof(double_width[0]);
+       i++) {
+    if (codepoint < double_width[i][0]) {
+      break;
+    }
+    if (codepoint <= double_width[i][1]) {
+      return 2;
+    }
+  }
+
+  return 1;
+}
+
+size_t string_slice_display_width(string_slice ss) {
+  size_t width = 0;
+  size_t index = 0;
+  uint32_t codepoint = 0;
+
+  while (index < ss.len) {
+    size_t ascii_end = skip_ascii(ss, index);
+
+    width += ascii_end - index;
+    index = ascii_end;
+
+    if (index == ss.len) {
+      break;
+    }
+
+    size_t length = decode_utf8(ss, index, &codepoint);
+
+    if (length == 0) {
+      // Invalid byte, shown as a single replacement character.
+      width++;
+      index++;
+    } else {
+      width += codepoint_width(codepoint);
+      index += length;
+    }
+  }
+
+  return width;
 }
@@ -0,0 +1,417 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+#define THREAD_POOL_QUEUE_INITIAL_CAPACITY 64
+// Chunks given to every worker when the caller doesn't pick a grain.
+#define THREAD_POOL_CHUNKS_PER_WORKER 8
+
+typedef struct thread_pool_job thread_pool_job;
+
+typedef struct thread_pool_task {
+  thread_pool_job *job;
+  unsigned int begin;
+  unsigned int end;
+} thread_pool_task;
+
+typedef struct thread_pool_queue {
+  pthread_mutex_t lock;
+  thread_pool_task *tasks;  // Ring buffer of tasks.
+  unsigned int capacity;    // Always a power of 2.
+  unsigned int head;        // Where other workers steal from.
+  unsigned int tail;        // Where the owner pushes and pops.
+} thread_pool_queue;
+
+struct thread_pool_job {
+  int (*fn)(unsigned int, unsigned int, void *);
+  void *ctx;
+  unsigned int remaining;  // Chunks not yet processed, guarded by pool lock.
+  int result;              // First failure, guarded by pool lock.
+};
+
+struct thread_pool {
+  pthread_t *threads;
+  thread_pool_queue *queues;  // One queue per worker.
+  unsigned int size;          // Number of workers.
+  unsigned int num_queues;    // Number of initialized queues.
+  unsigned int queued;        // Tasks waiting in all queues.
+  int shutdown;               // Workers exit once set.
+  pthread_mutex_t lock;
+  pthread_cond_t work_available;  // Signaled when tasks are queued.
+  pthread_cond_t work_done;       // Signaled when a job finishes.
+};
+
+typedef struct thread_pool_worker {
+  thread_pool *pool;
+  unsigned int index;
+} thread_pool_worker;
+
+// Pool and queue of the worker running on this thread, if any.
+static __thread thread_pool *current_pool = NULL;
+static __thread unsigned int current_index = 0;
+
+static thread_pool *default_pool = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Add a task to the back of the queue.
+ *
+ * @return 0 on success, 2 indicates memory allocation failed.
+ */
+static int queue_push(thread_pool_queue *queue, thread_pool_task *task) {
+  int result = STATUS_SUCCESS;
+
+  pthread_mutex_lock(&queue->lock);
+
+  if (queue->tail - queue->head == queue->capacity) {
+    unsigned int capacity = queue->capacity << 1;
+    thread_pool_task *tasks = malloc(sizeof(thread_pool_task) * capacity);
+
+    if (tasks == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    for (unsigned int i = queue->head; i != queue->tail; i++) {
+      tasks[i & (capacity - 1)] = queue->tasks[i & (queue->capacity - 1)];
+    }
+
+    free(queue->tasks);
+    queue->tasks = tasks;
+    queue->capacity = capacity;
+  }
+
+  queue->tasks[queue->tail++ & (queue->capacity - 1)] = *task;
+
+defer:
+  pthread_mutex_unlock(&queue->lock);
+  return result;
+}
+
+/**
+ * Take a task from the back(owner) or the front(thief) of the queue.
+ *
+ * @return 0 on success, 3 indicates queue is empty.
+ */
+static int queue_take(thread_pool_queue *queue, thread_pool_task *task,
+                      int steal) {
+  int result = STATUS_SUCCESS;
+
+  pthread_mutex_lock(&queue->lock);
+
+  if (queue->head == queue->tail) {
+    RETURN_DEFER(STATUS_IS_EMPTY);
+  }
+
+  if (steal) {
+    *task = queue->tasks[queue->head++ & (queue->capacity - 1)];
+  } else {
+    *task = queue->tasks[--queue->tail & (queue->capacity - 1)];
+  }
+
+defer:
+  pthread_mutex_unlock(&queue->lock);
+  return result;
+}
+
+/**
+ * Take a task from the calling worker's queue, or steal one from another.
+ *
+ * @return 0 on success, 3 indicates every queue is empty.
+ */
+static int take_task(thread_pool *pool, thread_pool_task *task) {
+  int result = STATUS_IS_EMPTY;
+  unsigned int start = 0;
+
+  if (current_pool == pool) {
+    if (queue_take(&pool->queues[current_index], task, 0) == 0) {
+      RETURN_DEFER(STATUS_SUCCESS);
+    }
+    start = current_index + 1;
+  }
+
+  for (unsigned int i = 0; i < pool->num_queues; i++) {
+    if (queue_take(&pool->queues[(start + i) % pool->num_queues], task, 1) ==
+        0) {
+      RETURN_DEFER(STATUS_SUCCESS);
+    }
+  }
+
+defer:
+  if (result == STATUS_SUCCESS) {
+    pthread_mutex_lock(&pool->lock);
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return result;
+}
+
+/**
+ * Process a chunk and report it to its job.
+ */
+static void run_task(thread_pool *pool, thread_pool_task *task) {
+  thread_pool_job *job = task->job;
+  int status = job->fn(task->begin, task->end, job->ctx);
+
+  pthread_mutex_lock(&pool->lock);
+
+  if (status != 0 && job->result == STATUS_SUCCESS) {
+    job->result = STATUS_FAILURE;
+  }
+
+  if (--job->remaining == 0) {
+    pthread_cond_broadcast(&pool->work_done);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static void *worker_main(void *arg) {
+  thread_pool_worker *worker = arg;
+  thread_pool *pool = worker->pool;
+  thread_pool_task task;
+
+  current_pool = pool;
+  current_index = worker->index;
+  free(worker);
+
+  while (1) {
+    if (take_task(pool, &task) == 0) {
+      run_task(pool, &task);
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (pool->queued == 0 && !pool->shutdown) {
+      pthread_cond_wait(&pool->work_available, &pool->lock);
+    }
+
+    if (pool->queued == 0 && pool->shutdown) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+int thread_pool_create(thread_pool **pool, unsigned int num_threads) {
+  int result = STATUS_SUCCESS;
+
+  if (num_threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = cpus > 0 ? cpus : 1;
+  }
+
+  if ((*pool = malloc(sizeof(thread_pool))) == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  (*pool)->size = 0;
+  (*pool)->num_queues = 0;
+  (*pool)->queued = 0;
+  (*pool)->shutdown = 0;
+  (*pool)->threads = malloc(sizeof(pthread_t) * num_threads);
+  (*pool)->queues = malloc(sizeof(thread_pool_queue) * num_threads);
+  pthread_mutex_init(&(*pool)->lock, NULL);
+  pthread_cond_init(&(*pool)->work_available, NULL);
+  pthread_cond_init(&(*pool)->work_done, NULL);
+
+  if ((*pool)->threads == NULL || (*pool)->queues == NULL) {
+    RETURN_DEFER(STATUS_MEMORY_FAILURE);
+  }
+
+  for (unsigned int i = 0; i < num_threads; i++) {
+    thread_pool_queue *queue = &(*pool)->queues[i];
+
+    queue->capacity = THREAD_POOL_QUEUE_INITIAL_CAPACITY;
+    queue->head = 0;
+    queue->tail = 0;
+
+    if ((queue->tasks = malloc(sizeof(thread_pool_task) * queue->capacity)) ==
+        NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    (*pool)->num_queues++;
+  }
+
+  for (unsigned int i = 0; i < num_threads; i++) {
+    thread_pool_worker *worker = malloc(sizeof(thread_pool_worker));
+
+    if (worker == NULL) {
+      RETURN_DEFER(STATUS_MEMORY_FAILURE);
+    }
+
+    worker->pool = *pool;
+    worker->index = i;
+
+    if (pthread_create(&(*pool)->threads[i], NULL, worker_main, worker) !=
+        0) {
+      free(worker);
+      RETURN_DEFER(STATUS_FAILURE);
+    }
+
+    (*pool)->size++;
+  }
+
+defer:
+  if (result != STATUS_SUCCESS && *pool != NULL) {
+    // Stops the workers already started.
+    thread_pool_destroy(pool);
+  }
+  return result;
+}
+
+static void destroy_default_pool(void) { thread_pool_destroy(&default_pool); }
+
+static void create_default_pool(void) {
+  if (thread_pool_create(&default_pool, 0) == STATUS_SUCCESS) {
+    atexit(destroy_default_pool);
+  }
+}
+
+int thread_pool_get_default(thread_pool **pool) {
+  int result = STATUS_SUCCESS;
+
+  pthread_once(&default_pool_once, create_default_pool);
+
+  if ((*pool = default_pool) == NULL) {
+    RETURN_DEFER(STATUS_FAILURE);
+  }
+
+defer:
+  return result;
+}
+
+int thread_pool_get_size(thread_pool *pool) {
+  if (pool == NULL) {
+    return -1;
+  }
+  return pool->size;
+}
+
+int thread_pool_parallel_for(thread_pool *pool, unsigned int length,
+                             unsigned int grain,
+                             int (*fn)(unsigned int begin, unsigned int end,
+                                       void *ctx),
+                             void *ctx) {
+  int result = STATUS_SUCCESS;
+
+  if (pool == NULL || fn == NULL) {
+    RETURN_DEFER(STATUS_IS_NULL);
+  }
+
+  if (length == 0) {
+    RETURN_DEFER(STATUS_SUCCESS);
+  }
+
+  // Without workers there is nobody to hand chunks to.
+  if (pool->size == 0) {
+    RETURN_DEFER(fn(0, length, ctx) == 0 ? STATUS_SUCCESS : STATUS_FAILURE);
+  }
+
+  if (grain == 0) {
+    grain = length / (pool->size * THREAD_POOL_CHUNKS_PER_WORKER);
+    grain = grain == 0 ? 1 : grain;
+  }
+
+  unsigned int chunks = length / grain + (length % grain != 0);
+
+  // Not worth handing out, run it on the calling thread.
+  if (chunks == 1) {
+    RETURN_DEFER(fn(0, length, ctx) == 0 ? STATUS_SUCCESS : STATUS_FAILURE);
+  }
+
+  thread_pool_job job = {fn, ctx, chunks, STATUS_SUCCESS};
+  thread_pool_task task = {&job, 0, 0};
+  unsigned int pushed = 0;
+
+  // Hand every worker a contiguous block of chunks, stealing evens them out.
+  for (unsigned int i = 0; i < chunks; i++) {
+    task.begin = i * grain;
+    task.end = task.begin + grain > length ? length : task.begin + grain;
+
+    // Counted before it is pushed, a worker may take it right away.
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (queue_push(&pool->queues[(unsigned long)i * pool->size / chunks],
+                   &task) != 0) {
+      pthread_mutex_lock(&pool->lock);
+      pool->queued--;
+      pthread_mutex_unlock(&pool->lock);
+      result = STATUS_MEMORY_FAILURE;
+      break;
+    }
+    pushed++;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  // Chunks that could not be queued are never going to finish.
+  job.remaining -= chunks - pushed;
+  pthread_cond_broadcast(&pool->work_available);
+  pthread_mutex_unlock(&pool->lock);
+
+  // Help until every chunk of this job has been taken.
+  while (1) {
+    if (take_task(pool, &task) == 0) {
+      run_task(pool, &task);
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (job.remaining == 0) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+
+    if (pool->queued == 0) {
+      pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  if (result == STATUS_SUCCESS) {
+    result = job.result;
+  }
+
+defer:
+  return result;
+}
+
+void thread_pool_destroy(thread_pool **pool) {
+  if (*pool != NULL) {
+    pthread_mutex_lock(&(*pool)->lock);
+    (*pool)->shutdown = 1;
+    pthread_cond_broadcast(&(*pool)->work_available);
+    pthread_mutex_unlock(&(*pool)->lock);
+
+    for (unsigned int i = 0; i < (*pool)->size; i++) {
+      pthread_join((*pool)->threads[i], NULL);
+    }
+
+    for (unsigned int i = 0; i < (*pool)->num_queues; i++) {
+      pthread_mutex_destroy(&(*pool)->queues[i].lock);
+      free((*pool)->queues[i].tasks);
+    }
+
+    pthread_mutex_destroy(&(*pool)->lock);
+    pthread_cond_destroy(&(*pool)->work_available);
+    pthread_cond_destroy(&(*pool)->work_done);
+    free((*pool)->threads);
+    free((*pool)->queues);
+    free(*pool);
+    *pool = NULL;
+  }
+}
@@ -0,0 +1,107 @@
+/*
+ * Parse tests for the argparser, run with 'make test'.
+ */
+
+#include "argparser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "output_sink.h"
+#include "string_builder.h"
+#include "test.h"
+
+/**
+ * Parse argv with a parser taking -v/--value and -o/--out, and optionally
+ * the positional src, writing the errors into output.
+ *
+ * @param with_positional whether src is registered.
+ * @param argc number of entries in argv.
+ * @param argv arguments, argv[0] being the program name.
+ * @param output string_builder receiving the errors.
+ *
+ * @return the result of argparser_parse_args.
+ */
+static int parse(bool with_positional, int argc, char *argv[],
+                 string_builder *output) {
+  argparser *parser = NULL;
+  output_sink *sink = NULL;
+  int result;
+
+  argparser_create(&parser);
+  argparser_add_name_to_argparser(&parser, "prog");
+  output_sink_create_memory(&sink, output);
+  argparser_add_sink_to_argparser(&parser, sink);
+
+  if (with_positional) {
+    argparser_add_argument(parser, NULL, "src");
+  }
+
+  argparser_add_argument(parser, "-v", "--value");
+  argparser_add_argument(parser, "-o", "--out");
+
+  result = argparser_parse_args(parser, argc, argv);
+
+  argparser_destroy(&parser);
+  output_sink_destroy(&sink);
+
+  return result;
+}
+
+/**
+ * -h after an option missing its value still asks for the help, with or
+ * without a positional argument waiting for input.
+ */
+static void test_help_after_missing_value(void) {
+  char *argv[] = {"prog", "-v", "-h"};
+
+  for (int with_positional = 0; with_positional < 2; with_positional++) {
+    string_builder *output = NULL;
+
+    string_builder_create(&output);
+    TEST_CHECK(parse(with_positional, 3, argv, output) == AP_HELP_REQUESTED);
+    TEST_CHECK(output->length == 0);
+    string_builder_destroy(&output);
+  }
+}
+
+/**
+ * An unrecognized option before the help request does not hide it.
+ */
+static void test_help_after_unrecognized(void) {
+  char *argv[] = {"prog", "--bogus", "-o", "x", "-v", "-h"};
+
+  for (int with_positional = 0; with_positional < 2; with_positional++) {
+    string_builder *output = NULL;
+
+    string_builder_create(&output);
+    TEST_CHECK(parse(with_positional, 6, argv, output) == AP_HELP_REQUESTED);
+    TEST_CHECK(output->length == 0);
+    string_builder_destroy(&output);
+  }
+}
+
+/**
+ * An option missing its value does not swallow the next option as a
+ * positional argument.
+ */
+static void test_missing_value_keeps_next_option(void) {
+  char *argv[] = {"prog", "-v", "-o", "x", "a"};
+  string_builder *output = NULL;
+
+  string_builder_create(&output);
+  TEST_CHECK(parse(true, 5, argv, output) == STATUS_SUCCESS);
+  TEST_CHECK(strstr(output->data, "argument -v: expected one argument") !=
+             NULL);
+  TEST_CHECK(strstr(output->data, "unrecognized") == NULL);
+  TEST_CHECK(strstr(output->data, "required") == NULL);
+  string_builder_destroy(&output);
+}
+
+int main(void) {
+  test_help_after_missing_value();
+  test_help_after_unrecognized();
+  test_missing_value_keeps_next_option();
+
+  return test_report("argparser");
+}
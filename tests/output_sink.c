@@ -0,0 +1,88 @@
+/*
+ * Tests for output_sink, run with 'make test'.
+ */
+
+#include "output_sink.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "string_builder.h"
+#include "test.h"
+
+static char first[] = "usage: prog ";
+static char empty[] = "";
+static char second[] = "[-h]\n";
+
+static struct iovec pieces[] = {
+    {.iov_base = first, .iov_len = sizeof(first) - 1},
+    {.iov_base = empty, .iov_len = 0},
+    {.iov_base = second, .iov_len = sizeof(second) - 1},
+};
+
+/**
+ * Append the text handed to a callback sink to the string_builder in ctx.
+ */
+static int collect(const char *data, size_t length, void *ctx) {
+  return string_builder_append(ctx, data, length);
+}
+
+/**
+ * A file descriptor sink writes what it buffered before the pieces.
+ */
+static void test_writev_fd(void) {
+  output_sink *sink = NULL;
+  char read_back[64] = {0};
+  int fds[2];
+
+  TEST_CHECK(pipe(fds) == 0);
+  output_sink_create_fd(&sink, fds[1]);
+
+  TEST_CHECK(output_sink_write(sink, "> ", 2) == STATUS_SUCCESS);
+  TEST_CHECK(output_sink_writev(sink, pieces, 3) == STATUS_SUCCESS);
+
+  // Delivered on return, nothing is left for the flush.
+  TEST_CHECK(read(fds[0], read_back, sizeof(read_back) - 1) == 19);
+  TEST_CHECK(strcmp(read_back, "> usage: prog [-h]\n") == 0);
+
+  output_sink_destroy(&sink);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+/**
+ * Memory and callback sinks copy the pieces in order.
+ */
+static void test_writev_copies(void) {
+  output_sink *sink = NULL;
+  string_builder *memory = NULL;
+  string_builder *collected = NULL;
+
+  string_builder_create(&memory);
+  output_sink_create_memory(&sink, memory);
+  TEST_CHECK(output_sink_writev(sink, pieces, 3) == STATUS_SUCCESS);
+  TEST_CHECK(memory->length == 17 &&
+             memcmp(memory->data, "usage: prog [-h]\n", 17) == 0);
+  output_sink_destroy(&sink);
+
+  string_builder_create(&collected);
+  output_sink_create_callback(&sink, collect, collected);
+  TEST_CHECK(output_sink_writev(sink, pieces, 3) == STATUS_SUCCESS);
+  TEST_CHECK(output_sink_flush(sink) == STATUS_SUCCESS);
+  TEST_CHECK(collected->length == 17 &&
+             memcmp(collected->data, "usage: prog [-h]\n", 17) == 0);
+  output_sink_destroy(&sink);
+
+  TEST_CHECK(output_sink_writev(NULL, pieces, 3) == STATUS_IS_NULL);
+
+  string_builder_destroy(&memory);
+  string_builder_destroy(&collected);
+}
+
+int main(void) {
+  test_writev_fd();
+  test_writev_copies();
+
+  return test_report("output_sink");
+}
@@ -0,0 +1,94 @@
+/*
+ * Tests for string_array, run with 'make test'.
+ */
+
+#include "string_array.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "logger.h"
+#include "test.h"
+
+/**
+ * Check that array holds exactly the strings in expected, in order.
+ */
+static void check_strings(string_array *array, const char **expected,
+                          int count) {
+  TEST_CHECK(string_array_get_size(array) == count);
+
+  for (int i = 0; i < count && i < string_array_get_size(array); i++) {
+    const char *str = NULL;
+    unsigned int length = 0;
+
+    string_array_get(array, i, &str, &length);
+    TEST_CHECK(length == strlen(expected[i]));
+    TEST_CHECK(strcmp(str, expected[i]) == 0);
+  }
+}
+
+/**
+ * The first of equal strings is kept and the order is preserved, strings
+ * that only share a prefix or a length are all kept.
+ */
+static void test_dedup_keeps_first(void) {
+  const char *input[] = {"b", "",          "a",        "path/to/a",
+                         "b", "path/to/b", "",         "path/to/a",
+                         "a", "path/to/",  "abcd",     "abce"};
+  const char *expected[] = {"b",         "",         "a",    "path/to/a",
+                            "path/to/b", "path/to/", "abcd", "abce"};
+  string_array *array = NULL;
+
+  string_array_create(&array);
+
+  for (unsigned int i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+    string_array_append(array, input[i], strlen(input[i]));
+  }
+
+  TEST_CHECK(string_array_dedup(array) == STATUS_SUCCESS);
+  check_strings(array, expected, sizeof(expected) / sizeof(expected[0]));
+
+  // The array stays usable, added strings go after the ones kept.
+  string_array_append(array, "c", 1);
+  TEST_CHECK(string_array_get_size(array) == 9);
+
+  string_array_destroy(&array);
+}
+
+/**
+ * Deduplicating many strings keeps one of each.
+ */
+static void test_dedup_many(void) {
+  string_array *array = NULL;
+  char str[32];
+
+  string_array_create(&array);
+
+  for (int i = 0; i < 10000; i++) {
+    int length = snprintf(str, sizeof(str), "/usr/include/sub%d", i % 1000);
+
+    string_array_append(array, str, length);
+  }
+
+  TEST_CHECK(string_array_dedup(array) == STATUS_SUCCESS);
+  TEST_CHECK(string_array_get_size(array) == 1000);
+
+  for (int i = 0; i < 1000 && i < string_array_get_size(array); i++) {
+    const char *kept = NULL;
+
+    snprintf(str, sizeof(str), "/usr/include/sub%d", i);
+    string_array_get(array, i, &kept, NULL);
+    TEST_CHECK(strcmp(kept, str) == 0);
+  }
+
+  TEST_CHECK(string_array_dedup(NULL) == STATUS_IS_NULL);
+
+  string_array_destroy(&array);
+}
+
+int main(void) {
+  test_dedup_keeps_first();
+  test_dedup_many();
+
+  return test_report("string_array");
+}
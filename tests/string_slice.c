@@ -0,0 +1,240 @@
+/*
+ * Tests for string_slice, run with 'make test'.
+ */
+
+#include "string_slice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "test.h"
+
+/**
+ * Length of the well formed sequence at bytes[0], 0 if there is none.
+ * Follows the table of well formed byte sequences of the Unicode
+ * standard, independently of string_slice.
+ */
+static size_t reference_sequence(const unsigned char *bytes, size_t available) {
+  static const unsigned char ranges[][5] = {
+      // lead low, lead high, second byte low, second byte high, length
+      {0xC2, 0xDF, 0x80, 0xBF, 2}, {0xE0, 0xE0, 0xA0, 0xBF, 3},
+      {0xE1, 0xEC, 0x80, 0xBF, 3}, {0xED, 0xED, 0x80, 0x9F, 3},
+      {0xEE, 0xEF, 0x80, 0xBF, 3}, {0xF0, 0xF0, 0x90, 0xBF, 4},
+      {0xF1, 0xF3, 0x80, 0xBF, 4}, {0xF4, 0xF4, 0x80, 0x8F, 4},
+  };
+
+  if (bytes[0] < 0x80) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+    size_t length = ranges[i][4];
+
+    if (bytes[0] < ranges[i][0] || bytes[0] > ranges[i][1]) {
+      continue;
+    }
+
+    if (available < length || bytes[1] < ranges[i][2] ||
+        bytes[1] > ranges[i][3]) {
+      return 0;
+    }
+
+    for (size_t j = 2; j < length; j++) {
+      if (bytes[j] < 0x80 || bytes[j] > 0xBF) {
+        return 0;
+      }
+    }
+
+    return length;
+  }
+
+  return 0;
+}
+
+/**
+ * Position of the first invalid sequence, length when there is none.
+ */
+static size_t reference_error(const unsigned char *bytes, size_t length) {
+  size_t index = 0;
+
+  while (index < length) {
+    size_t sequence = reference_sequence(bytes + index, length - index);
+
+    if (sequence == 0) {
+      break;
+    }
+
+    index += sequence;
+  }
+
+  return index;
+}
+
+/**
+ * Check validate_utf8 against the reference on bytes.
+ */
+static void check_utf8(const unsigned char *bytes, size_t length) {
+  size_t expected = reference_error(bytes, length);
+  size_t error_index = 0;
+  int result =
+      string_slice_validate_utf8(string_slice_make((char *)bytes, length),
+                                 &error_index);
+
+  TEST_CHECK(result == (expected == length ? STATUS_SUCCESS : STATUS_FAILURE));
+  TEST_CHECK(error_index == expected);
+}
+
+/**
+ * Valid text with one or two random bytes replaced, so errors land on
+ * every position relative to the 16 byte blocks.
+ */
+static void test_validate_utf8_random(void) {
+  static const char *pieces[] = {
+      "a", "path/", "\xC3\xA9", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF",
+      "\xEF\xBF\xBD", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "0123456789",
+  };
+  static const unsigned char interesting[] = {
+      0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1,
+      0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xF8, 0xFF,
+  };
+  unsigned char bytes[96];
+
+  srand(1);
+
+  for (int round = 0; round < 200000; round++) {
+    size_t length = 0;
+    size_t target = rand() % (sizeof(bytes) - 4);
+
+    while (length < target) {
+      const char *piece = pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+      size_t piece_length = strlen(piece);
+
+      if (length + piece_length > sizeof(bytes)) {
+        break;
+      }
+
+      memcpy(bytes + length, piece, piece_length);
+      length += piece_length;
+    }
+
+    for (int changes = rand() % 3; changes > 0 && length > 0; changes--) {
+      bytes[rand() % length] =
+          interesting[rand() % sizeof(interesting)];
+    }
+
+    check_utf8(bytes, length);
+
+    // Truncating cuts sequences at the end.
+    if (length > 0) {
+      check_utf8(bytes, length - 1 - rand() % (length < 4 ? length : 4));
+    }
+  }
+}
+
+/**
+ * Every sequence of up to three bytes, after enough ASCII to start it at
+ * each position of a 16 byte block.
+ */
+static void test_validate_utf8_sequences(void) {
+  unsigned char bytes[40];
+
+  for (unsigned int value = 0; value < 1 << 24; value += 1 + value % 7) {
+    size_t offset = value % 19;
+
+    memset(bytes, 'x', sizeof(bytes));
+    bytes[offset] = value >> 16;
+    bytes[offset + 1] = value >> 8;
+    bytes[offset + 2] = value;
+    check_utf8(bytes, sizeof(bytes));
+  }
+}
+
+/**
+ * string_slice_find agrees with a plain search on small alphabets, where
+ * candidates are frequent, around the filter and Two-Way needle lengths.
+ */
+static void test_find_random(void) {
+  char haystack[300];
+  char needle[100];
+
+  srand(2);
+
+  for (int round = 0; round < 200000; round++) {
+    size_t haystack_length = rand() % sizeof(haystack);
+    size_t needle_length = 1 + rand() % sizeof(needle);
+    int alphabet = 1 + rand() % 3;
+    size_t expected = haystack_length;
+
+    for (size_t i = 0; i < haystack_length; i++) {
+      haystack[i] = 'a' + rand() % alphabet;
+    }
+
+    for (size_t i = 0; i < needle_length; i++) {
+      needle[i] = 'a' + rand() % alphabet;
+    }
+
+    if (needle_length <= haystack_length && rand() % 2) {
+      memcpy(haystack + rand() % (haystack_length - needle_length + 1), needle,
+             needle_length);
+    }
+
+    for (size_t i = 0; i + needle_length <= haystack_length; i++) {
+      if (memcmp(haystack + i, needle, needle_length) == 0) {
+        expected = i;
+        break;
+      }
+    }
+
+    TEST_CHECK(string_slice_find(string_slice_make(haystack, haystack_length),
+                                 string_slice_make(needle, needle_length)) ==
+               expected);
+  }
+}
+
+/**
+ * string_slice_find_any agrees with a plain search for sets of every size,
+ * ASCII or not, and fields shorter and longer than sixteen characters.
+ */
+static void test_find_any_random(void) {
+  unsigned char text[200];
+  unsigned char set[40];
+
+  srand(3);
+
+  for (int round = 0; round < 100000; round++) {
+    size_t text_length = rand() % sizeof(text);
+    size_t set_length = 1 + rand() % sizeof(set);
+    // Small sets make long fields, half the rounds are not only ASCII.
+    int spread = rand() % 2 ? 128 : 256;
+    size_t expected = text_length;
+
+    for (size_t i = 0; i < text_length; i++) {
+      text[i] = rand() % spread;
+    }
+
+    for (size_t i = 0; i < set_length; i++) {
+      set[i] = rand() % spread;
+    }
+
+    for (size_t i = 0; i < text_length && expected == text_length; i++) {
+      if (memchr(set, text[i], set_length) != NULL) {
+        expected = i;
+      }
+    }
+
+    TEST_CHECK(string_slice_find_any(
+                   string_slice_make((char *)text, text_length),
+                   (const char *)set, set_length) == expected);
+  }
+}
+
+int main(void) {
+  test_validate_utf8_random();
+  test_validate_utf8_sequences();
+  test_find_random();
+  test_find_any_random();
+
+  return test_report("string_slice");
+}
@@ -0,0 +1,37 @@
+#ifndef TEST_H
+#define TEST_H
+
+/*
+ * Helpers shared by the tests, built and run with 'make test'.
+ */
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+/**
+ * Record a failure, with its location, when cond does not hold.
+ */
+#define TEST_CHECK(cond)                                               \
+  do {                                                                 \
+    if (!(cond)) {                                                     \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #cond);                                                  \
+      test_failures++;                                                 \
+    }                                                                  \
+  } while (0)
+
+/**
+ * Print the outcome of a test program.
+ *
+ * @param name what was tested.
+ *
+ * @return 0 when every check held, 1 otherwise.
+ */
+static inline int test_report(const char *name) {
+  printf("  %-40s %s\n", name, test_failures == 0 ? "ok" : "FAILED");
+
+  return test_failures == 0 ? 0 : 1;
+}
+
+#endif  // TEST_H